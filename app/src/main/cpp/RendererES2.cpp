@@ -18,26 +18,44 @@
 
 #include "gles3jni.h"
 
-// TODO: Rewrite this Renderer implementation to render heat-diffusion simulation.
+// Draws the grid texture like RendererES3, for devices without ES3.  The
+// texture formats that need ES3 fall back to TEX_LUMINANCE.
+
+#define STR(s) #s
+#define STRV(s) STR(s)
 
 static const char VERTEX_SHADER[] =
     "#version 100\n"
-    "uniform mat2 scaleRot;\n"
-    "uniform vec2 offset;\n"
+    "uniform mat4 u_Modelview;\n"
     "attribute vec2 pos;\n"
-    "attribute vec4 color;\n"
-    "varying vec4 vColor;\n"
+    "attribute vec2 texCoord;\n"
+    "varying vec2 vTexCoord;\n"
     "void main() {\n"
-    "    gl_Position = vec4(scaleRot*pos + offset, 0.0, 1.0);\n"
-    "    vColor = color;\n"
+    "    gl_Position = u_Modelview * vec4(pos, 0.0, 1.0);\n"
+    "    vTexCoord = texCoord;\n"
     "}\n";
 
 static const char FRAGMENT_SHADER[] =
     "#version 100\n"
+    // The palette coordinate needs more than mediump's 11 bits, where the
+    // GPU has more.
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
     "precision mediump float;\n"
-    "varying vec4 vColor;\n"
+    "#endif\n"
+    "const float PALETTE = " STRV(COLORMAP_SIZE) ".0;\n"
+    "varying vec2 vTexCoord;\n"
+    "uniform sampler2D ourTexture;\n"
+    "uniform sampler2D lut;\n"
+    "uniform float lutScale;\n"
     "void main() {\n"
-    "    gl_FragColor = vColor;\n"
+    "    vec4 c = texture2D(ourTexture, vTexCoord);\n"
+    "    if (lutScale > 0.0) {\n"
+    "        float s = clamp(c.r * lutScale, 0.0, 1.0);\n"
+    "        c = texture2D(lut, vec2((s * (PALETTE - 1.0) + 0.5) / PALETTE, 0.5));\n"
+    "    }\n"
+    "    gl_FragColor = c;\n"
     "}\n";
 
 class RendererES2 : public Renderer {
@@ -57,7 +75,6 @@ class RendererES2 : public Renderer {
 };
 
 Renderer* createES2Renderer() {
-  ALOGE("ES2 Renderer not currently supported.");
   auto* renderer = new RendererES2;
   if (!renderer->init()) {
     delete renderer;
@@ -81,6 +98,8 @@ bool RendererES2::init() {
   glGenBuffers(1, &mVB);
   glBindBuffer(GL_ARRAY_BUFFER, mVB);
   glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD), &QUAD[0], GL_STATIC_DRAW);
+  glGenTextures(1, &texName);
+  initColormap();
 
   ALOGV("Using OpenGL ES 2.0 renderer");
   return true;
@@ -95,23 +114,24 @@ RendererES2::~RendererES2() {
    */
   if (eglGetCurrentContext() != mEglContext) return;
   glDeleteBuffers(1, &mVB);
+  glDeleteTextures(1, &texName);
+  glDeleteTextures(1, &lutName);
   glDeleteProgram(mProgram);
 }
 
 void RendererES2::draw() {
-//  glUseProgram(mProgram);
-//
-//  glBindBuffer(GL_ARRAY_BUFFER, mVB);
-//  glVertexAttribPointer(mPosAttrib, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-//                        (const GLvoid*)offsetof(Vertex, pos));
-//  glVertexAttribPointer(mColorAttrib, 4, GL_UNSIGNED_BYTE, GL_TRUE,
-//                        sizeof(Vertex), (const GLvoid*)offsetof(Vertex, rgba));
-//  glEnableVertexAttribArray(mPosAttrib);
-//  glEnableVertexAttribArray(mColorAttrib);
-//
-//  for (unsigned int i = 0; i < numInstances; i++) {
-//    glUniformMatrix2fv(mScaleRotUniform, 1, GL_FALSE, mScaleRot + 4 * i);
-//    glUniform2fv(mOffsetUniform, 1, mOffsets + 2 * i);
-//    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-//  }
+  glUseProgram(mProgram);
+  bindTextures();
+
+  glBindBuffer(GL_ARRAY_BUFFER, mVB);
+  glVertexAttribPointer(mPosAttrib, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        (const GLvoid*)offsetof(Vertex, pos));
+  glVertexAttribPointer(mTexCoordAttrib, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        (const GLvoid*)offsetof(Vertex, texCoord));
+  glEnableVertexAttribArray(mPosAttrib);
+  glEnableVertexAttribArray(mTexCoordAttrib);
+
+  // QUAD runs around the quad, so it draws as a fan; ES2 has no 32-bit
+  // indices for the ES3 renderer's element array.
+  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 }
@@ -39,12 +39,21 @@ static const char VERTEX_SHADER[] =
 
 static const char FRAGMENT_SHADER[] =
         "#version 300 es\n"
-        "precision mediump float;\n"
+        // The palette coordinate needs more than mediump's 11 bits.
+        "precision highp float;\n"
+        "const float PALETTE = " STRV(COLORMAP_SIZE) ".0;\n"
         "out vec4 FragColor;\n"
         "in vec2 TexCoord;\n"
         "uniform sampler2D ourTexture;\n"
+        "uniform sampler2D lut;\n"
+        "uniform float lutScale;\n"
         "void main() {\n"
-        "    FragColor = texture(ourTexture, TexCoord);\n"
+        "    vec4 c = texture(ourTexture, TexCoord);\n"
+        "    if (lutScale > 0.0) {\n"
+        "        float s = clamp(c.r * lutScale, 0.0, 1.0);\n"
+        "        c = texture(lut, vec2((s * (PALETTE - 1.0) + 0.5) / PALETTE, 0.5));\n"
+        "    }\n"
+        "    FragColor = c;\n"
         "}\n";
 
 class RendererES3 : public Renderer {
@@ -81,6 +90,8 @@ bool RendererES3::init() {
   glGenBuffers(1, &EBO);
   glGenBuffers(VB_COUNT, mVB);
   glGenTextures(1, &texName);
+  es3 = true;
+  initColormap();
 
   glGenVertexArrays(1, &mVBState);
   glBindVertexArray(mVBState);
@@ -115,12 +126,14 @@ RendererES3::~RendererES3() {
   glDeleteBuffers(VB_COUNT, mVB);
   glDeleteVertexArrays(1, &EBO);
   glDeleteTextures(1, &texName);
+  glDeleteTextures(1, &lutName);
+  glDeleteBuffers(2, pbo);
   glDeleteProgram(mProgram);
 }
 
 void RendererES3::draw() {
   glUseProgram(mProgram);
-  glBindTexture(GL_TEXTURE_2D, texName);
+  bindTextures();
   glBindVertexArray(mVBState);
 
   // Draw the quad
@@ -0,0 +1,83 @@
+/* Registry of the stencil algorithms that can drive the simulation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "algorithms.h"
+
+const Algorithm algorithms[] = {
+    {"loops_serial", rect_loops_serial, ALG_STENCIL,
+     "serial loops over t, x, y"},
+    {"loops_parallel", rect_loops_parallel,
+     ALG_STENCIL | ALG_PARALLEL | ALG_FUSED_OUTPUT,
+     "cilk_for over rows of the peeled row kernel for each timestep"},
+    {"walk2", rect_recursive_serial,
+     ALG_STENCIL | ALG_RECURSIVE | ALG_FUSED_OUTPUT | ALG_USES_LT_THRESH,
+     "serial trapezoidal walk"},
+    {"walk_dp_t", rect_recursive_dp_t,
+     ALG_STENCIL | ALG_RECURSIVE | ALG_PARALLEL | ALG_FUSED_OUTPUT |
+         ALG_USES_COARSEN,
+     "dual partition, time coarsening only"},
+    {"walk_dp_xyt", rect_recursive_dp_xyt,
+     ALG_STENCIL | ALG_RECURSIVE | ALG_PARALLEL | ALG_FUSED_OUTPUT |
+         ALG_USES_STOPS,
+     "dual partition, x_stop/y_stop/dt_stop base case"},
+    {"walk_dp_xy_ucut", rect_recursive_dp_xy_ucut,
+     ALG_STENCIL | ALG_RECURSIVE | ALG_PARALLEL | ALG_FUSED_OUTPUT |
+         ALG_USES_STOPS,
+     "upright/inverted cuts, space cuts only within dt_stop"},
+    {"walk_dp_xyt_ucut", rect_recursive_dp_ucut,
+     ALG_STENCIL | ALG_RECURSIVE | ALG_PARALLEL | ALG_FUSED_OUTPUT |
+         ALG_USES_STOPS,
+     "upright/inverted cuts at the midpoint"},
+    {"walk_dp_xyt_ucut2", rect_recursive_dp_ucut2,
+     ALG_STENCIL | ALG_RECURSIVE | ALG_PARALLEL | ALG_FUSED_OUTPUT |
+         ALG_USES_STOPS,
+     "upright/inverted cuts into thirds"},
+    {"walk_dp_xyt_ucut_fixed", rect_recursive_dp_ucut_fixed,
+     ALG_STENCIL | ALG_RECURSIVE | ALG_PARALLEL | ALG_FUSED_OUTPUT |
+         ALG_USES_STOPS,
+     "upright/inverted cuts with fixed x_stop/y_stop blocks"},
+    // The overlapping cuts of walk_dp_cq recompute the overlap into the
+    // same two time planes, so later timesteps clobber values the other
+    // half still needs.
+    {"walk_dp_cq", rect_recursive_dp_cq,
+     ALG_STENCIL | ALG_RECURSIVE | ALG_PARALLEL | ALG_EXPERIMENTAL |
+         ALG_USES_STOPS,
+     "overlapping two-way cuts (experimental, inexact)"},
+    {"null", rect_null, 0,
+     "heat injection only, no stencil"},
+};
+
+const int num_algorithms = sizeof(algorithms) / sizeof(algorithms[0]);
+
+const Algorithm *find_algorithm(const char *name) {
+  for (int i = 0; i < num_algorithms; ++i) {
+    if (!strcmp(name, algorithms[i].name))
+      return &algorithms[i];
+  }
+  return nullptr;
+}
+
+const Algorithm *default_algorithm() {
+  static const Algorithm *const a = find_algorithm(DEFAULT_ALGORITHM);
+  assert(a);
+  return a;
+}
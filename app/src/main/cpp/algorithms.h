@@ -0,0 +1,69 @@
+/* Registry of the stencil algorithms that can drive the simulation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_ALGORITHMS_H
+#define CILKHEATDEMO2_ALGORITHMS_H
+
+#include "common.h"
+
+// Signature shared by all rect_* entry points: advance the rectangle
+// [x0, x1) x [y0, y1) from timestep t0 to t1.
+typedef void (*rect_fn)(const SimState *Q,
+                        int t0, int t1,
+                        int x0, int x1,
+                        int y0, int y1);
+
+// Capability flags of an algorithm.
+enum {
+  ALG_PARALLEL = 1 << 0,      // Spawns parallel work.
+  ALG_RECURSIVE = 1 << 1,     // Cache-oblivious trapezoidal decomposition.
+  ALG_STENCIL = 1 << 2,       // Computes the heat equation (rect_null does not).
+  ALG_EXPERIMENTAL = 1 << 3,  // Known not to match rect_loops_serial.
+  ALG_FUSED_OUTPUT = 1 << 4,  // Computes through SimView::kernel_row, so
+                              // honors SimState::output and changes.
+  // Which of SimState::walk the algorithm reads, and so autotune searches.
+  ALG_USES_STOPS = 1 << 5,      // x_stop, y_stop and dt_stop.
+  ALG_USES_COARSEN = 1 << 6,    // coarsen.
+  ALG_USES_LT_THRESH = 1 << 7,  // lt_thresh.
+};
+
+struct Algorithm {
+  const char *name;
+  rect_fn fn;
+  unsigned flags;
+  const char *description;
+};
+
+extern const Algorithm algorithms[];
+extern const int num_algorithms;
+
+// Name of the algorithm used when nothing else is selected, which the
+// renderer has always used.
+#define DEFAULT_ALGORITHM "walk_dp_xyt_ucut"
+
+// The algorithm registered under DEFAULT_ALGORITHM.
+const Algorithm *default_algorithm();
+
+// Returns the algorithm registered under name, or nullptr.
+const Algorithm *find_algorithm(const char *name);
+
+#endif //CILKHEATDEMO2_ALGORITHMS_H
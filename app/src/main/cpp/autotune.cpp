@@ -0,0 +1,266 @@
+/* Per-device tuning of the walkers' cutoffs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <vector>
+#include <unistd.h>
+#include "autotune.h"
+#include "frame_stats.h"
+#include "timing.h"
+
+// Contents of a small text file with trailing whitespace removed, or "".
+static std::string read_line(const std::string &path) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f)
+    return "";
+  char buf[256];
+  std::string s = fgets(buf, sizeof(buf), f) ? buf : "";
+  fclose(f);
+  while (!s.empty() && isspace((unsigned char) s.back()))
+    s.pop_back();
+  return s;
+}
+
+// The model name of an x86 CPU, or the implementer and distinct part
+// numbers of the cores of an ARM one (big.LITTLE SoCs list several).
+static std::string cpu_model() {
+  FILE *f = fopen("/proc/cpuinfo", "r");
+  if (!f)
+    return "unknown";
+  std::string model, implementer, parts;
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    const char *colon = strchr(line, ':');
+    if (!colon)
+      continue;
+    std::string name(line, colon - line), value(colon + 1);
+    while (!name.empty() && isspace((unsigned char) name.back()))
+      name.pop_back();
+    while (!value.empty() && isspace((unsigned char) value.front()))
+      value.erase(0, 1);
+    while (!value.empty() && isspace((unsigned char) value.back()))
+      value.pop_back();
+    if (name == "model name" && model.empty())
+      model = value;
+    else if (name == "CPU implementer" && implementer.empty())
+      implementer = value;
+    else if (name == "CPU part" && (" " + parts + " ").find(" " + value + " ") == std::string::npos)
+      parts += parts.empty() ? value : " " + value;
+  }
+  fclose(f);
+  if (!model.empty())
+    return model;
+  if (!parts.empty())
+    return implementer + ":" + parts;
+  return "unknown";
+}
+
+// Sizes of cpu0's caches as sysfs reports them, e.g. "L1d:32K,L2:1024K".
+static std::string cache_sizes() {
+  std::string s;
+  for (int i = 0; i < 8; ++i) {
+    std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/";
+    std::string level = read_line(dir + "level"), size = read_line(dir + "size");
+    if (level.empty() || size.empty())
+      continue;
+    std::string type = read_line(dir + "type");
+    std::string suffix = type == "Data" ? "d" : type == "Instruction" ? "i" : "";
+    s += (s.empty() ? "L" : ",L") + level + suffix + ":" + size;
+  }
+  return s.empty() ? "nocache" : s;
+}
+
+std::string device_fingerprint() {
+  std::string s = cpu_model() + "|" + std::to_string(sysconf(_SC_NPROCESSORS_CONF)) + "|" +
+                  cache_sizes();
+  // Keep the key one whitespace-free field of the tuning file.
+  for (char &c : s)
+    if (isspace((unsigned char) c))
+      c = '_';
+  return s;
+}
+
+bool valid_walk_params(const WalkParams &p) {
+  return p.x_stop > 0 && p.y_stop > 0 && p.dt_stop > 0 && p.lt_thresh > 0 && p.coarsen > 0;
+}
+
+namespace {
+
+// A cutoff that autotune searches, and the values it tries.
+struct Knob {
+  unsigned flag;  // ALG_USES_* of the algorithms that read it.
+  const char *name;
+  int WalkParams::*field;
+  std::vector<int> values;
+};
+
+const Knob knobs[] = {
+    {ALG_USES_STOPS, "x_stop", &WalkParams::x_stop, {16, 32, 48, 64, 96, 128, 192, 256}},
+    {ALG_USES_STOPS, "y_stop", &WalkParams::y_stop, {16, 32, 48, 64, 96, 128, 192, 256}},
+    {ALG_USES_STOPS, "dt_stop", &WalkParams::dt_stop, {1, 2, 3, 4, 5, 6, 8, 10, 12, 16}},
+    {ALG_USES_LT_THRESH, "lt_thresh", &WalkParams::lt_thresh, {4, 8, 16, 32, 64, 128}},
+    {ALG_USES_COARSEN, "coarsen", &WalkParams::coarsen, {1, 2, 3, 4, 5, 6, 8, 10, 12, 16}},
+};
+
+void print_params(const char *prefix, const WalkParams &p, double rate) {
+  printf("%s x_stop %d y_stop %d dt_stop %d lt_thresh %d coarsen %d: %.4g cells/s\n", prefix,
+         p.x_stop, p.y_stop, p.dt_stop, p.lt_thresh, p.coarsen, rate);
+}
+
+}  // namespace
+
+WalkParams autotune(const Algorithm *algo, const TuneOptions &opts, double *rate,
+                    bool *complete) {
+  uint64_t start = now_ns();
+  bool finished = true;
+  SimState *Q = new SimState(opts.X, opts.Y, true, opts.layout, opts.precision);
+  Q->set_sim_size(opts.X, opts.Y, opts.T);
+  double cells = double(opts.X) * opts.Y * opts.T;
+  auto measure = [&](const WalkParams &p) {
+    Q->walk = p;
+    return cells / time_algorithm(algo, Q, opts.T, opts.reps);
+  };
+
+  WalkParams best;
+  double best_rate = measure(best);
+  if (opts.verbose)
+    print_params("start", best, best_rate);
+  // Coordinate descent: the cutoffs interact only mildly, so a few passes
+  // over one at a time get close to the best of the whole grid of them.
+  for (int pass = 0; pass < 3; ++pass) {
+    bool improved = false;
+    for (const Knob &k : knobs) {
+      if (!(algo->flags & k.flag))
+        continue;
+      for (int v : k.values) {
+        if (v == best.*k.field)
+          continue;
+        if (opts.budget_ns && now_ns() - start > opts.budget_ns) {
+          finished = false;
+          break;
+        }
+        WalkParams p = best;
+        p.*k.field = v;
+        double r = measure(p);
+        if (opts.verbose)
+          print_params("  try", p, r);
+        if (r > best_rate * TUNE_GAIN) {
+          best = p;
+          best_rate = r;
+          improved = true;
+        }
+      }
+    }
+    if (!finished) {
+      if (opts.verbose)
+        print_params("out of time", best, best_rate);
+      break;
+    }
+    if (opts.verbose)
+      print_params(improved ? "pass" : "done", best, best_rate);
+    if (!improved)
+      break;
+  }
+  delete Q;
+  if (rate)
+    *rate = best_rate;
+  if (complete)
+    *complete = finished;
+  return best;
+}
+
+std::string tune_key(const Algorithm *algo, const TuneOptions &opts) {
+  return device_fingerprint() + "|" + algo->name + "|" + layout_name(opts.layout) + "|" +
+         precision_name(opts.precision) + "|" + std::to_string(opts.X) + "x" +
+         std::to_string(opts.Y);
+}
+
+// Reads the lines of path into lines, which stays empty if there is none.
+static void read_lines(const char *path, std::vector<std::string> &lines) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return;
+  char buf[1024];
+  while (fgets(buf, sizeof(buf), f)) {
+    std::string line(buf);
+    if (!line.empty() && line.back() == '\n')
+      line.pop_back();
+    if (!line.empty())
+      lines.push_back(line);
+  }
+  fclose(f);
+}
+
+bool load_walk_params(const char *path, const std::string &key, WalkParams *p) {
+  std::vector<std::string> lines;
+  read_lines(path, lines);
+  for (const std::string &line : lines) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos || line.compare(0, tab, key) != 0 || tab != key.size())
+      continue;
+    WalkParams q;
+    if (sscanf(line.c_str() + tab + 1, "%d %d %d %d %d", &q.x_stop, &q.y_stop, &q.dt_stop,
+               &q.lt_thresh, &q.coarsen) != 5 || !valid_walk_params(q))
+      return false;
+    *p = q;
+    return true;
+  }
+  return false;
+}
+
+bool save_walk_params(const char *path, const std::string &key, const WalkParams &p,
+                      double rate) {
+  std::vector<std::string> lines;
+  read_lines(path, lines);
+  char entry[1024];
+  snprintf(entry, sizeof(entry), "%s\t%d %d %d %d %d\t%.4g", key.c_str(), p.x_stop, p.y_stop,
+           p.dt_stop, p.lt_thresh, p.coarsen, rate);
+  bool replaced = false;
+  for (std::string &line : lines) {
+    if (line.compare(0, key.size() + 1, key + "\t") == 0) {
+      line = entry;
+      replaced = true;
+    }
+  }
+  if (!replaced)
+    lines.push_back(entry);
+  // Write a new file and rename it over the old one, so that a crash
+  // never leaves a truncated file behind.
+  std::string tmp = std::string(path) + ".tmp";
+  FILE *f = fopen(tmp.c_str(), "w");
+  if (!f)
+    return false;
+  for (const std::string &line : lines)
+    fprintf(f, "%s\n", line.c_str());
+  bool ok = fclose(f) == 0;
+  return ok && rename(tmp.c_str(), path) == 0;
+}
+
+bool tuned_walk_params(const char *path, const Algorithm *algo, const TuneOptions &opts,
+                       bool retune, WalkParams *p) {
+  std::string key = tune_key(algo, opts);
+  if (!retune && load_walk_params(path, key, p))
+    return true;
+  double rate;
+  bool complete;
+  *p = autotune(algo, opts, &rate, &complete);
+  return !complete || save_walk_params(path, key, *p, rate);
+}
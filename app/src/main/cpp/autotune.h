@@ -0,0 +1,85 @@
+/* Per-device tuning of the walkers' cutoffs.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_AUTOTUNE_H
+#define CILKHEATDEMO2_AUTOTUNE_H
+
+#include <string>
+#include "common.h"
+#include "sim.h"
+#include "algorithms.h"
+
+// Names this device for the tuning file: CPU model, number of cores and
+// cache sizes, e.g. "Intel(R)_Xeon(R)_Gold_6248|80|L1d:32K,L1i:32K,L2:1024K".
+std::string device_fingerprint();
+
+// Smallest speedup that autotune takes for more than noise.
+#define TUNE_GAIN 1.02
+
+// Time that the app gives autotune (see TuneOptions::budget_ns).
+#define APP_TUNE_BUDGET_NS 10000000000ull
+
+// The representative grid that autotune times on; the defaults are the
+// renderer's layout and precision on a phone-sized grid.
+struct TuneOptions {
+  int X = 512, Y = 512;
+  int T = DEFAULT_TSTEP;
+  SimLayout layout = LAYOUT_TIME_OUTER;
+  SimPrecision precision = PREC_FLOAT;
+  int reps = 3;
+  bool verbose = false;  // Print each configuration tried.
+  // Wall time after which autotune stops trying cutoffs and keeps the best
+  // so far; 0 for no limit.
+  uint64_t budget_ns = 0;
+};
+
+// Whether the walkers can run with p: every cutoff must be positive.
+bool valid_walk_params(const WalkParams &p);
+
+// Searches the cutoffs that algo reads (see ALG_USES_*) for the fastest,
+// one at a time from the defaults, until a pass over all of them finds
+// nothing at least TUNE_GAIN faster, for at most three passes, or until
+// opts.budget_ns runs out.  Returns them, their cells per second in *rate
+// and, in *complete if not null, whether the budget let the search finish.
+WalkParams autotune(const Algorithm *algo, const TuneOptions &opts, double *rate,
+                    bool *complete = nullptr);
+
+// Key of algo's entry in the tuning file for this device and the layout,
+// precision and grid size of opts.
+std::string tune_key(const Algorithm *algo, const TuneOptions &opts);
+
+// The tuning file holds a line per key: the key, a tab, the five cutoffs
+// in WalkParams order and, after another tab, their cells per second.
+// load returns false if there is no valid entry for key; save replaces it
+// and returns false if the file cannot be written.
+bool load_walk_params(const char *path, const std::string &key, WalkParams *p);
+bool save_walk_params(const char *path, const std::string &key, const WalkParams &p,
+                      double rate);
+
+// Sets *p to algo's entry for this device from path or, if there is none
+// or retune is set, runs autotune and saves the result, unless the budget
+// cut the search short, so that the next call searches again.  Returns
+// false if a finished result could not be saved; *p holds it all the same.
+bool tuned_walk_params(const char *path, const Algorithm *algo, const TuneOptions &opts,
+                       bool retune, WalkParams *p);
+
+#endif  // CILKHEATDEMO2_AUTOTUNE_H
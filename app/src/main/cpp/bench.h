@@ -0,0 +1,98 @@
+/* Shared helpers for the host-side heat_bench driver.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_BENCH_H
+#define CILKHEATDEMO2_BENCH_H
+
+#include <vector>
+#include "common.h"
+#include "sim.h"
+#include "algorithms.h"
+#include "frame_stats.h"
+#include "autotune.h"
+#include "timing.h"
+#include "step_budget.h"
+
+// Number of Cilk workers of this process (1 in serial builds).
+unsigned num_workers();
+
+// Parse comma-separated lists of layout and precision names.  Return false
+// on malformed input.
+bool parse_layout_list(const char *str, std::vector<SimLayout> &out);
+bool parse_precision_list(const char *str, std::vector<SimPrecision> &out);
+
+// Parses a comma-separated list of positive integers.  Returns false on
+// malformed input.
+bool parse_int_list(const char *str, std::vector<int> &out);
+
+struct SuiteOptions {
+  std::vector<int> sizes;    // Square grid sizes.
+  std::vector<int> tsteps;   // Timesteps per run.
+  std::vector<int> workers;  // Values of CILK_NWORKERS to sweep.
+  std::vector<const Algorithm *> algos;
+  std::vector<SimLayout> layouts;
+  std::vector<SimPrecision> precisions;
+  int reps = 5;
+  bool json = false;
+  // Set in the re-executed child that measures one worker count.
+  bool child = false;
+};
+
+// Benchmark suite: times every algorithm on every grid size, timestep count,
+// layout and precision for each worker count and prints CSV or JSON with
+// median time, cells/s, speedup and parallel efficiency.  Each worker count
+// runs in a re-executed copy of argv0, since CILK_NWORKERS is read only at
+// runtime startup.
+int run_suite(const char *argv0, const SuiteOptions &opts);
+
+// Verification mode: runs every stencil algorithm from identical, randomized
+// SimState contents (grid size, raster pattern, time range) in every
+// layout and precision, with dense or sparse heat, and compares the
+// resulting grid element-wise against rect_loops_serial on the time-inner
+// layout in the same precision.  Also reports how far the float and mixed
+// results are from double.  Then checks that resize_sim keeps a smooth
+// field and leaves a state that steps like a fresh one.  Returns nonzero
+// if any non-experimental algorithm differs or a resize check fails.
+int run_verify(int trials, unsigned seed);
+
+// Precision report: runs algo for T timesteps from init_state on an X by Y
+// grid in every precision and prints the error of float and mixed against
+// double, both in value and in the 8-bit color shown on screen, along with
+// the throughput of each.
+int run_precision_report(int X, int Y, int T, const Algorithm *algo);
+
+// Frame report: replays the renderer's frame loop without GL, T timesteps
+// of algo per frame on an X by Y grid with a moving heat source followed by
+// the conversion to RGBA texels (or fused into the stencil), for frames
+// frames, and prints the phase timings of the last FrameStats::WINDOW.
+// With a deadline, a StepBudget chooses each frame's timesteps instead.
+int run_frame_report(int X, int Y, int T, int frames, const Algorithm *algo, SimLayout layout,
+                     SimPrecision precision, bool fused, uint64_t deadline_ns);
+
+// Walk profile: runs each of algos for T timesteps on an X by Y grid from
+// init_state, under the hooks of walk_profile.h, and prints the work, span,
+// parallelism, burdened parallelism, spawns and leaves of one call, and a
+// histogram of the leaf sizes.  Fails unless built with WALK_PROFILE.
+int run_walk_profile(int X, int Y, int T, const std::vector<const Algorithm *> &algos,
+                     SimLayout layout, SimPrecision precision);
+
+#endif //CILKHEATDEMO2_BENCH_H
@@ -0,0 +1,174 @@
+/* Benchmark suite comparing the stencil algorithms across grid sizes,
+ * timestep counts and worker counts.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "bench.h"
+
+namespace {
+
+struct SuiteResult {
+  const Algorithm *algo;
+  SimLayout layout;
+  SimPrecision precision;
+  int size;
+  int tstep;
+  int workers;
+  double median;  // Seconds per run.
+};
+
+// Times every configuration in this process and appends the results.
+void run_configs(const SuiteOptions &opts, std::vector<SuiteResult> &results) {
+  int workers = int(num_workers());
+  for (SimPrecision precision : opts.precisions) {
+    for (SimLayout layout : opts.layouts) {
+      for (int size : opts.sizes) {
+        SimState *Q = new SimState(size, size, true, layout, precision);
+        for (int T : opts.tsteps) {
+          Q->set_sim_size(size, size, T);
+          for (const Algorithm *algo : opts.algos) {
+            double median = time_algorithm(algo, Q, T, opts.reps);
+            results.push_back({algo, layout, precision, size, T, workers, median});
+            if (opts.child) {
+              printf("%s %s %s %d %d %d %.9e\n", algo->name, layout_name(layout),
+                     precision_name(precision), size, T, workers, median);
+              fflush(stdout);
+            } else {
+              fprintf(stderr, "%s %s %s %dx%d T=%d P=%d: %.6f s\n", algo->name,
+                      layout_name(layout), precision_name(precision), size, size, T, workers,
+                      median);
+            }
+          }
+        }
+        delete Q;
+      }
+    }
+  }
+}
+
+#ifdef __cilk
+std::string join(const std::vector<int> &v) {
+  std::string s;
+  for (size_t i = 0; i < v.size(); ++i) {
+    if (i > 0)
+      s += ',';
+    s += std::to_string(v[i]);
+  }
+  return s;
+}
+
+// Re-executes argv0 with CILK_NWORKERS=workers and collects its results.
+bool run_child(const char *argv0, const SuiteOptions &opts, int workers,
+               std::vector<SuiteResult> &results) {
+  std::string cmd = std::string("'") + argv0 + "' -S -Z -r " + std::to_string(opts.reps)
+                    + " -g " + join(opts.sizes) + " -t " + join(opts.tsteps) + " -a ";
+  for (size_t i = 0; i < opts.algos.size(); ++i)
+    cmd += std::string(i > 0 ? "," : "") + opts.algos[i]->name;
+  cmd += " -L ";
+  for (size_t i = 0; i < opts.layouts.size(); ++i)
+    cmd += std::string(i > 0 ? "," : "") + layout_name(opts.layouts[i]);
+  cmd += " -P ";
+  for (size_t i = 0; i < opts.precisions.size(); ++i)
+    cmd += std::string(i > 0 ? "," : "") + precision_name(opts.precisions[i]);
+  setenv("CILK_NWORKERS", std::to_string(workers).c_str(), 1);
+  FILE *child = popen(cmd.c_str(), "r");
+  if (!child) {
+    perror("popen");
+    return false;
+  }
+  char name[64], layout_str[64], precision_str[64];
+  int size, T, P;
+  double median;
+  while (fscanf(child, "%63s %63s %63s %d %d %d %le", name, layout_str, precision_str, &size, &T,
+                &P, &median) == 7) {
+    const Algorithm *algo = find_algorithm(name);
+    std::vector<SimLayout> layout;
+    std::vector<SimPrecision> precision;
+    if (algo && parse_layout_list(layout_str, layout) &&
+        parse_precision_list(precision_str, precision)) {
+      results.push_back({algo, layout[0], precision[0], size, T, P, median});
+      fprintf(stderr, "%s %s %s %dx%d T=%d P=%d: %.6f s\n", name, layout_str, precision_str,
+              size, size, T, P, median);
+    }
+  }
+  return pclose(child) == 0;
+}
+#endif
+
+}  // namespace
+
+int run_suite(const char *argv0, const SuiteOptions &opts) {
+  std::vector<SuiteResult> results;
+  if (opts.child) {
+    run_configs(opts, results);
+    return 0;
+  }
+
+#ifdef __cilk
+  for (int w : opts.workers) {
+    if (!run_child(argv0, opts, w, results)) {
+      fprintf(stderr, "benchmark run with CILK_NWORKERS=%d failed\n", w);
+      return 1;
+    }
+  }
+#else
+  if (opts.workers.size() > 1 || opts.workers[0] != 1)
+    fprintf(stderr, "serial build: ignoring worker counts, running with 1 worker\n");
+  run_configs(opts, results);
+#endif
+
+  // Speedup and efficiency are relative to the same configuration on the
+  // smallest worker count measured.
+  if (opts.json)
+    printf("[\n");
+  else
+    printf("algorithm,layout,precision,x,y,tsteps,workers,median_s,cells_per_s,speedup,"
+           "efficiency\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const SuiteResult &r = results[i];
+    const SuiteResult *base = &r;
+    for (const SuiteResult &b : results)
+      if (b.algo == r.algo && b.layout == r.layout && b.precision == r.precision &&
+          b.size == r.size && b.tstep == r.tstep && b.workers < base->workers)
+        base = &b;
+    double rate = double(r.size) * r.size * r.tstep / r.median;
+    double speedup = base->median / r.median;
+    double efficiency = speedup * base->workers / r.workers;
+    if (opts.json) {
+      printf("  {\"algorithm\": \"%s\", \"layout\": \"%s\", \"precision\": \"%s\", "
+             "\"x\": %d, \"y\": %d, \"tsteps\": %d, \"workers\": %d, \"median_s\": %.9g, "
+             "\"cells_per_s\": %.6g, \"speedup\": %.4f, \"efficiency\": %.4f}%s\n",
+             r.algo->name, layout_name(r.layout), precision_name(r.precision), r.size, r.size,
+             r.tstep, r.workers, r.median, rate, speedup, efficiency,
+             i + 1 < results.size() ? "," : "");
+    } else {
+      printf("%s,%s,%s,%d,%d,%d,%d,%.9g,%.6g,%.4f,%.4f\n", r.algo->name, layout_name(r.layout),
+             precision_name(r.precision), r.size, r.size, r.tstep,
+             r.workers, r.median, rate, speedup, efficiency);
+    }
+  }
+  if (opts.json)
+    printf("]\n");
+  return 0;
+}
@@ -31,11 +31,18 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 #include <sys/time.h>
+// Serial builds (e.g. host builds without OpenCilk) elide the Cilk keywords.
+#ifdef __cilk
 #include <cilk/cilk.h>
+#else
+#include <cilk/cilk_stub.h>
+#endif
 
 #define min(x, y)  (x<y?x:y)
 #define max(x, y)  (x>y?x:y)
@@ -44,6 +51,8 @@ class SimState;
 
 //#define TexImage(Q, x, y, z) (texImage[(4 * (((Q)->Ysep * (x)) + (y))) + z])
 //#define TexImage(Q, x, y, z) (texImage[(4 * (((Q)->Xsep * ((Q)->Y - 1 - (y))) + (x))) + z])
+// The texture is always row-major, as glTexImage2D expects, whatever the
+// layout of u; renderTexture converts between the two.
 #define TexImage(Q, x, y, z) (texImage[(4 * (((Q)->Xsep * (y)) + (x))) + z])
 
 /*********************************************************/
@@ -55,11 +64,41 @@ void rect_recursive_serial(const SimState *Q,
                            int x0, int x1,
                            int y0, int y1);
 
+void rect_recursive_dp_t(const SimState *Q,
+                         int t0, int t1,
+                         int x0, int x1,
+                         int y0, int y1);
+
+void rect_recursive_dp_xyt(const SimState *Q,
+                           int t0, int t1,
+                           int x0, int x1,
+                           int y0, int y1);
+
+void rect_recursive_dp_xy_ucut(const SimState *Q,
+                               int t0, int t1,
+                               int x0, int x1,
+                               int y0, int y1);
+
 void rect_recursive_dp_ucut(const SimState *Q,
                             int t0, int t1,
                             int x0, int x1,
                             int y0, int y1);
 
+void rect_recursive_dp_ucut2(const SimState *Q,
+                             int t0, int t1,
+                             int x0, int x1,
+                             int y0, int y1);
+
+void rect_recursive_dp_ucut_fixed(const SimState *Q,
+                                  int t0, int t1,
+                                  int x0, int x1,
+                                  int y0, int y1);
+
+void rect_recursive_dp_cq(const SimState *Q,
+                          int t0, int t1,
+                          int x0, int x1,
+                          int y0, int y1);
+
 void rect_loops_serial(const SimState *Q,
                        int t0, int t1,
                        int x0, int x1,
@@ -70,4 +109,9 @@ void rect_loops_parallel(const SimState *Q,
                          int x0, int x1,
                          int y0, int y1);
 
+void rect_null(const SimState *Q,
+               int t0, int t1,
+               int x0, int x1,
+               int y0, int y1);
+
 #endif
@@ -0,0 +1,74 @@
+/* Per-tile change tracking for partial texture updates.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "dirty_tiles.h"
+
+void DirtyTiles::reset(int X, int Y) {
+  this->X = X;
+  this->Y = Y;
+  nx = tiles_for(X);
+  ny = tiles_for(Y);
+  int n = count();
+  shown = (uint8_t *) realloc(shown, n);
+  changed = (uint8_t *) realloc(changed, n);
+  actions = (uint8_t *) realloc(actions, n);
+  codes = (uint16_t *) realloc(codes, size_t(X) * Y * sizeof(uint16_t));
+  memset(changed, 0, n);
+  forget();
+  invalidate();
+}
+
+void DirtyTiles::forget_tile(int i) {
+  int x0, x1, y0, y1;
+  cells(i, &x0, &x1, &y0, &y1);
+  for (int y = y0; y < y1; ++y)
+    for (int x = x0; x < x1; ++x)
+      codes[size_t(y) * X + x] = CODE_UNKNOWN;
+}
+
+void DirtyTiles::plan(bool tracked) {
+  for (int i = 0; i < count(); ++i) {
+    if (!shown[i]) {
+      // Whatever the codes hold, the texture does not show it; checking
+      // against no code at all converts the tile and records its codes.
+      forget_tile(i);
+      actions[i] = TILE_CHECK;
+      shown[i] = 1;
+    } else if (tracked) {
+      actions[i] = changed[i] ? TILE_CONVERT : TILE_SKIP;
+    } else {
+      actions[i] = TILE_CHECK;
+    }
+  }
+}
+
+void DirtyTiles::plan_changed(const long *changed_at, long since) {
+  for (int i = 0; i < count(); ++i) {
+    if (shown[i] && changed_at[i] <= since) {
+      actions[i] = TILE_SKIP;
+      continue;
+    }
+    actions[i] = TILE_CONVERT;
+    shown[i] = 1;
+    forget_tile(i);
+  }
+}
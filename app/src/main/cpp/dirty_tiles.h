@@ -0,0 +1,168 @@
+/* Per-tile change tracking for partial texture updates.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_DIRTY_TILES_H
+#define CILKHEATDEMO2_DIRTY_TILES_H
+
+#include "common.h"
+#include "sim.h"
+
+// Tiles are DIRTY_TILE cells square; a multiple of the layouts' tiles.
+#define DIRTY_TILE 32
+
+// Code that no temperature has (see color_code), for cells whose code the
+// texture is not known to show.
+#define CODE_UNKNOWN 0xFFFF
+
+// Decides from frame to frame which tiles of the texture can look different
+// from what it already shows, so that the renderer converts and uploads
+// only those.  A tile changes when a cell's 8-bit code (see color_code)
+// changes; the other components then differ by at most one step.
+//
+// The codes that the texture shows are kept for every cell.  A stencil run
+// with the ChangeSink of track compares the cells of its last timestep
+// with them as it computes them and flags the tiles that changed, so the
+// others are not read at all.  When the grid changed in some other way,
+// check_row compares every tile instead.
+class DirtyTiles {
+public:
+  enum Action : uint8_t {
+    TILE_SKIP,     // The texture already shows the tile.
+    TILE_CHECK,    // Convert if check_row finds a change, else skip.
+    TILE_CONVERT,  // Convert; the codes are already the cells'.
+  };
+
+  ~DirtyTiles() {
+    free(shown);
+    free(changed);
+    free(actions);
+    free(codes);
+  }
+
+  // Tracks a grid of X by Y cells whose contents are unknown.
+  void reset(int X, int Y);
+
+  // Forgets what the texture shows, as when it is reallocated, so that
+  // the next plan draws every tile.
+  void invalidate() {
+    memset(shown, 0, count());
+  }
+
+  // Forgets the codes, as when the grid changed without a ChangeSink, so
+  // that the next stencil run with one flags every tile.
+  void forget() {
+    for (size_t i = 0; i < size_t(X) * Y; ++i)
+      codes[i] = CODE_UNKNOWN;
+  }
+
+  // Clears the flags and returns the sink that collects them for a stencil
+  // run whose last timestep is t.
+  ChangeSink track(long t) {
+    memset(changed, 0, count());
+    return {t, codes, X, changed, nx, DIRTY_TILE};
+  }
+
+  // Whether the run of the last track flagged tile i.
+  bool is_changed(int i) const {
+    return changed[i];
+  }
+
+  static int tiles_for(int cells) {
+    return (cells + DIRTY_TILE - 1) / DIRTY_TILE;
+  }
+
+  // Chooses each tile's action for this frame: from the flags of the last
+  // track if tracked, that is, if the grid changed since the last plan
+  // only by a stencil run with its sink; otherwise by checking every tile.
+  // Tiles that the texture does not show are converted either way.
+  void plan(bool tracked);
+
+  // Same, for a grid at another time than the one planned last, whose
+  // tiles changed since then where changed_at[i] > since.  The codes of
+  // the tiles converted are forgotten, since nothing recorded them.
+  void plan_changed(const long *changed_at, long since);
+
+  // Marks every tile for converting, as when the texture was written
+  // whole, with the codes recorded through a ChangeSink.
+  void convert_all() {
+    memset(actions, TILE_CONVERT, count());
+    memset(shown, 1, count());
+  }
+
+  int count() const {
+    return nx * ny;
+  }
+
+  int tiles_x() const {
+    return nx;
+  }
+
+  int tiles_y() const {
+    return ny;
+  }
+
+  Action action(int i) const {
+    return Action(actions[i]);
+  }
+
+  // Tile i turned out not to have changed.
+  void skip(int i) {
+    actions[i] = TILE_SKIP;
+  }
+
+  // Compares n cells of row y from x on, S elements apart at src, with the
+  // codes that the texture shows, and records them; returns whether any
+  // differed.
+  template<int S, typename T>
+  bool check_row(int x, int y, const T *src, int n) {
+    uint16_t *code = codes + size_t(y) * X + x;
+    bool changed = false;
+    for (int k = 0; k < n; ++k) {
+      uint16_t q = color_code(float(src[S * k]));
+      changed |= q != code[k];
+      code[k] = q;
+    }
+    return changed;
+  }
+
+  // Cells [x0, x1) x [y0, y1) of tile i.
+  void cells(int i, int *x0, int *x1, int *y0, int *y1) const {
+    int tx = i % nx, ty = i / nx;
+    *x0 = tx * DIRTY_TILE;
+    *x1 = min(*x0 + DIRTY_TILE, X);
+    *y0 = ty * DIRTY_TILE;
+    *y1 = min(*y0 + DIRTY_TILE, Y);
+  }
+
+private:
+  // Sets the codes of tile i to CODE_UNKNOWN.
+  void forget_tile(int i);
+
+  int X = 0, Y = 0;
+  int nx = 0, ny = 0;
+  uint8_t *shown = nullptr;    // Whether the texture holds the tile at all.
+  uint8_t *changed = nullptr;  // Flags of the ChangeSink of track.
+  uint8_t *actions = nullptr;
+  uint16_t *codes = nullptr;  // X * Y, row by row.
+};
+
+#endif  // CILKHEATDEMO2_DIRTY_TILES_H
@@ -0,0 +1,98 @@
+/* Host replay of the renderer's frame loop, for its phase timings.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <climits>
+#include <vector>
+#include "bench.h"
+
+int run_frame_report(int X, int Y, int T, int frames, const Algorithm *algo, SimLayout layout,
+                     SimPrecision precision, bool fused, uint64_t deadline_ns) {
+  SimState *Q = new SimState(X, Y, true, layout, precision);
+  Q->set_sim_size(X, Y, T);
+  Q->clear();
+  Q->heat_inc = 0.2f;
+  // RGBA texels, as the renderer's TEX_RGBA holds them.
+  std::vector<unsigned char> tex(size_t(4) * Q->Xsep * Q->Ysep);
+  OutputSink sink = {0, OUT_RGBA, tex.data(), size_t(4) * Q->Xsep};
+  fused = fused && (algo->flags & ALG_FUSED_OUTPUT);
+  FrameStats stats;
+  StepBudget budget;
+  budget.set_deadline(deadline_ns);
+
+  char steps[64];
+  if (deadline_ns)
+    snprintf(steps, sizeof(steps), "timesteps for a %.1f ms deadline", double(deadline_ns) * 1e-6);
+  else
+    snprintf(steps, sizeof(steps), "%d timesteps per frame", T);
+  printf("algorithm %s, grid %d x %d, %s, %d frames, layout %s, precision %s, %s conversion, "
+         "%u workers\n", algo->name, X, Y, steps, frames, layout_name(layout),
+         precision_name(precision), fused ? "fused" : "separate", num_workers());
+  int r = max(1, min(X, Y) / 32);
+  long t = 0;
+  int min_steps = INT_MAX, max_steps = 0;
+  long total_steps = 0;
+  uint64_t last = 0;
+  for (int f = 0; f < frames; ++f) {
+    uint64_t start = now_ns();
+    // Budgeted, the first frame is owed nothing, as in the renderer.
+    if (deadline_ns)
+      T = last ? budget.plan(start - last, double(X) * Y) : 0;
+    last = start;
+    min_steps = min(min_steps, T);
+    max_steps = max(max_steps, T);
+    total_steps += T;
+    // A touch circling the middle of the grid.
+    Q->clear_raster();
+    double a = 0.05 * f;
+    int cx = int(X / 2 + X / 4 * cos(a)), cy = int(Y / 2 + Y / 4 * sin(a));
+    for (int x = max(cx - r, 0); x < min(cx + r, X); ++x)
+      for (int y = max(cy - r, 0); y < min(cy + r, Y); ++y)
+        Q->set_raster(x, y, 1);
+    Q->update_heat_dirty();
+    uint64_t lap = stats.lap(PHASE_RASTER, start);
+
+    sink.t = t + T;
+    Q->output = fused ? &sink : nullptr;
+    algo->fn(Q, int(t), int(t + T), 0, X, 0, Y);
+    Q->output = nullptr;
+    t += T;
+    uint64_t done = now_ns();
+    uint64_t stencil = done - lap;
+    stats.record_stencil(stencil, double(X) * Y * T);
+    lap = done;
+
+    if (!fused) {
+      with_sim_view(Q, [&](auto *V) {
+        cilk_for (int y = 0; y < Y; ++y)
+          V->output_row(&sink, int(t), y, 0, X);
+      });
+      lap = stats.lap(PHASE_CONVERT, lap);
+    }
+    uint64_t end = stats.lap(PHASE_FRAME, start);
+    budget.record(T, double(X) * Y, stencil, end - start - stencil);
+  }
+  stats.print(stdout);
+  printf("timesteps per frame: min %d, mean %.1f, max %d; %.1f owed at the end\n", min_steps,
+         double(total_steps) / frames, max_steps, budget.owed());
+  delete Q;
+  return 0;
+}
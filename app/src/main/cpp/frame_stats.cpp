@@ -0,0 +1,65 @@
+/* Per-phase frame timing.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include "frame_stats.h"
+
+FrameStats::Summary FrameStats::summary(FramePhase p) const {
+  const Ring &r = rings[p];
+  int n = int(min(r.count, uint32_t(WINDOW)));
+  if (n == 0)
+    return {0, 0, 0, 0};
+  uint32_t sorted[WINDOW];
+  memcpy(sorted, r.ns, n * sizeof(uint32_t));
+  std::sort(sorted, sorted + n);
+  // Nearest rank: the smallest sample with at least q of them at or below.
+  auto rank = [&](double q) {
+    int k = int(ceil(q * n)) - 1;
+    return float(sorted[max(k, 0)] * 1e-6);
+  };
+  return {rank(0.50), rank(0.95), rank(0.99), n};
+}
+
+double FrameStats::cells_per_second() const {
+  const Ring &r = rings[PHASE_STENCIL];
+  int n = int(min(r.count, uint32_t(WINDOW)));
+  double cells = 0, ns = 0;
+  for (int i = 0; i < n; ++i) {
+    cells += stencil_cells[i];
+    ns += r.ns[i];
+  }
+  return ns > 0 ? cells / (ns * 1e-9) : 0;
+}
+
+void FrameStats::print(FILE *f) const {
+  fprintf(f, "%-8s %8s %8s %8s %8s\n", "phase", "p50 ms", "p95 ms", "p99 ms", "samples");
+  for (int i = 0; i < NUM_PHASES; ++i) {
+    Summary s = summary(FramePhase(i));
+    if (s.samples == 0) {
+      fprintf(f, "%-8s %8s %8s %8s %8d\n", phase_name(FramePhase(i)), "-", "-", "-", 0);
+      continue;
+    }
+    fprintf(f, "%-8s %8.3f %8.3f %8.3f %8d\n", phase_name(FramePhase(i)), s.p50_ms, s.p95_ms,
+            s.p99_ms, s.samples);
+  }
+  fprintf(f, "stencil: %.4g cells/s\n", cells_per_second());
+}
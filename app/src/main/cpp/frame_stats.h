@@ -0,0 +1,115 @@
+/* Per-phase frame timing.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_FRAME_STATS_H
+#define CILKHEATDEMO2_FRAME_STATS_H
+
+#include <ctime>
+#include "common.h"
+
+static inline uint64_t now_ns() {
+  timespec now{};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+// Phases of a frame, timed separately.  Upload and draw only queue work for
+// the GPU, so their times are what the CPU spends submitting it.
+enum FramePhase {
+  PHASE_RASTER,   // Drawing touches and sources into the raster.
+  PHASE_STENCIL,  // The frame's timesteps.
+  PHASE_CONVERT,  // Converting the grid to texels (renderTexture).
+  PHASE_UPLOAD,   // Handing the texels to GL (uploadTexture).
+  PHASE_DRAW,     // Drawing the textured quad.
+  PHASE_FRAME,    // The whole frame, from the start of step to the end of draw.
+  NUM_PHASES
+};
+
+static inline const char *phase_name(FramePhase p) {
+  switch (p) {
+    case PHASE_RASTER: return "raster";
+    case PHASE_STENCIL: return "stencil";
+    case PHASE_CONVERT: return "convert";
+    case PHASE_UPLOAD: return "upload";
+    case PHASE_DRAW: return "draw";
+    case PHASE_FRAME: return "frame";
+    default: return "unknown";
+  }
+}
+
+// Durations of the last WINDOW samples of each phase, with percentiles
+// computed only when asked for, so that recording costs a clock read and a
+// store.  Stencil samples also carry the number of cell updates, which
+// gives the solver's throughput.  Not thread-safe; the renderer records and
+// reads on the GL thread.
+class FrameStats {
+public:
+  static constexpr int WINDOW = 256;
+
+  struct Summary {
+    float p50_ms, p95_ms, p99_ms;
+    int samples;  // Number the percentiles are taken over, up to WINDOW.
+  };
+
+  void record(FramePhase p, uint64_t ns) {
+    Ring &r = rings[p];
+    r.ns[r.count % WINDOW] = uint32_t(min(ns, uint64_t(UINT32_MAX)));
+    r.count++;
+  }
+
+  // Records phase p as ending now, having begun at since; returns now, the
+  // start of whatever phase follows.
+  uint64_t lap(FramePhase p, uint64_t since) {
+    uint64_t now = now_ns();
+    record(p, now - since);
+    return now;
+  }
+
+  // Records a stencil sample that updated cells cells.
+  void record_stencil(uint64_t ns, double cells) {
+    stencil_cells[rings[PHASE_STENCIL].count % WINDOW] = cells;
+    record(PHASE_STENCIL, ns);
+  }
+
+  void reset() {
+    for (Ring &r : rings)
+      r.count = 0;
+  }
+
+  Summary summary(FramePhase p) const;
+
+  // Cell updates per second over the stencil samples in the window, or 0.
+  double cells_per_second() const;
+
+  // Prints a table of the summaries and the throughput.
+  void print(FILE *f) const;
+
+private:
+  struct Ring {
+    uint32_t ns[WINDOW];
+    uint32_t count = 0;  // Samples ever recorded.
+  };
+  Ring rings[NUM_PHASES];
+  double stencil_cells[WINDOW];
+};
+
+#endif  // CILKHEATDEMO2_FRAME_STATS_H
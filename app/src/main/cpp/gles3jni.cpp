@@ -20,6 +20,7 @@
 #include <cstdlib>
 #include <string>
 #include <ctime>
+#include "autotune.h"
 
 // Modelview matrix (Scaling and identity)
 const float modelview[16] = {
@@ -130,7 +131,12 @@ static void printGlString(const char *name, GLenum s) {
 
 Renderer::Renderer() : mProgram(0), texName(0), mVBState(0), mLastFrameNs(0) {}
 
-Renderer::~Renderer() = default;
+Renderer::~Renderer() {
+  delete pipeline;
+  delete Q;
+  free(texImage);
+  free(padRow);
+}
 
 void Renderer::resize(int w, int h) {
   calcSceneParams(w, h);
@@ -144,19 +150,43 @@ void Renderer::calcSceneParams(unsigned int w, unsigned int h) {
   // Projection from window to grid.
   int rx = w / MUL;
   int ry = h / MUL;
-  // Clear old simulation state.
-  delete Q;
-  if (texImage) {
-    free(texImage);
+  // Stop the simulation thread with its newest grid in Q.
+  if (pipeline) {
+    t = pipeline->finish(Q);
+    delete pipeline;
+    pipeline = nullptr;
   }
-  // Set up simulation state.
-  Q = new SimState(rx, ry, true);
-  Q->set_sim_size(rx, ry, DEFAULT_TSTEP);
+  if (Q && Q->X == rx && Q->Y == ry) {
+    // Nothing to remap, as when the surface is recreated at the same size.
+  } else if (Q) {
+    // Carry the temperature field over into the new grid, in the buffers
+    // of the old one where they have room.
+    resize_sim(Q, t, rx, ry, &resizeScratch);
+  } else {
+    Q = new SimState(rx, ry, true, layout, precision);
+    Q->set_sim_size(rx, ry, DEFAULT_TSTEP);
+  }
+  Q->walk = walk;
+  budget.reset();
   // Compute X and Y scaling.
   Xscale = float(Q->X) / winW;
   Yscale = float(Q->Y) / winH;
-  texImage = (GLubyte *) calloc(GridSize(Q->Xsep, Q->Ysep) * 4, sizeof(GLubyte));
-  ALOGV("Q->Xsep %d, Q->Ysep %d, Grid Size %d\n", Q->Xsep, Q->Ysep, GridSize(Q->Xsep, Q->Ysep));
+  // The trails were in the old grid's coordinates.
+  for (Pointer &p : pointers)
+    p.ntrail = 0;
+  hx = min(hx, Q->X - 1);
+  hy = min(hy, Q->Y - 1);
+  // Room for four bytes per texel, the most any format takes; contents
+  // are left for the tiles to redraw.
+  if (Q->cells() * 4 > texImageBytes) {
+    free(texImage);
+    texImageBytes = Q->cells() * 4 + size_t(Q->cells() * 4 * RESHAPE_SLACK);
+    texImage = (GLubyte *) malloc(texImageBytes);
+  }
+  padRow = (GLubyte *) realloc(padRow, size_t(Q->Xsep) * 4);
+  tiles.reset(Q->X, Q->Y);
+  syncPipeline();
+  ALOGV("Q->Xsep %d, Q->Ysep %d, Grid Size %zu\n", Q->Xsep, Q->Ysep, Q->cells());
   ALOGV("Xscale %f, Yscale %f\n", Xscale, Yscale);
 
   glUseProgram(mProgram);
@@ -178,84 +208,357 @@ void Renderer::calcSceneParams(unsigned int w, unsigned int h) {
 //  glUniformMatrix4fv(projectionLoc, 1, GL_TRUE, projection);
   glUniformMatrix4fv(modelviewLoc, 1, GL_TRUE, modelview);
 
-  glBindTexture(GL_TEXTURE_2D, texName);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-  // render
-  renderTexture();
-
-  ALOGV("x %d, y %d, TexImage() = %x, %x\n", hx, hy, TexImage(Q, hx, hy, 2),
-        TexImage(Q, hx, hy, 3));
-  glBindTexture(GL_TEXTURE_2D, texName);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, Q->Xsep, Q->Ysep, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, texImage);
+  // render, serially if the simulation thread is already running
+  GLubyte *tex = beginTexture();
+  tiles.plan(false);
+  renderTexture(Q, t, tex, !pipeline);
+  uploadTexture();
 
   ALOGV("calcSceneParams: %d by %d\n", w, h);
 }
 
 void Renderer::step() {
-  timespec now{};
-  clock_gettime(CLOCK_MONOTONIC, &now);
-  auto nowNs = now.tv_sec * 1000000000ull + now.tv_nsec;
+  uint64_t nowNs = now_ns();
 
-  // rasterize the hot lines
-  recording = 1 - recording;
+  // rasterize the hot lines and sources
   {
-    int sum = 0;
-    short showing = 1 - recording;
-    Q->clear_raster_array();
-    if (nsegs[showing] > 0) {
-      for (int i = 0; i < nsegs[showing] - 1; i++)
-        sum += bres(hxs[showing][i], hys[showing][i], hxs[showing][i + 1],
-                    hys[showing][i + 1]);
-      if (nsegs[showing] == 1) {
-        Raster(Q, hys[showing][0], hxs[showing][0]) = hot;
+    Q->clear_raster();
+    touches.drain([&](const TouchEvent &e) {
+      Pointer &p = pointers[e.id];
+      if (e.up) {
+        if (p.down && p.ntrail > 0)
+          p.trail_x[p.ntrail++] = -1;
+        p.down = false;
+        return;
+      }
+      p.down = true;
+      hx = min(max(int(e.x * Xscale), 0), Q->X - 1);
+      hy = min(max(int(e.y * Yscale), 0), Q->Y - 1);
+      // Coalesce points that land on the same cell.
+      if (p.ntrail > 0 && p.trail_x[p.ntrail - 1] == hx && p.trail_y[p.ntrail - 1] == hy)
+        return;
+      p.trail_x[p.ntrail] = hx;
+      p.trail_y[p.ntrail] = hy;
+      p.ntrail++;
+    });
+
+    // Each pointer spreads total_heat_per_frame over its trail, and the
+    // hottest cell of all sets the unit of the raster levels.
+    float heat[MAX_POINTERS];
+    float peak = sources ? sources->peak_heat(total_heat_per_frame) : 0;
+    for (int i = 0; i < MAX_POINTERS; i++) {
+      heat[i] = total_heat_per_frame / (trail_steps(pointers[i]) + 1);
+      if (pointers[i].ntrail > 0)
+        peak = max(peak, heat[i]);
+    }
+    Q->heat_inc = peak > 0 ? peak / MAX_HEAT_LEVEL : total_heat_per_frame;
+
+    for (int i = 0; i < MAX_POINTERS; i++) {
+      Pointer &p = pointers[i];
+      if (p.ntrail == 0)
+        continue;
+      draw_level = max(heat_level(heat[i], Q->heat_inc), char(1));
+      draw_trail(p);
+      if (p.down && p.trail_x[p.ntrail - 1] >= 0) {
+        p.trail_x[0] = p.trail_x[p.ntrail - 1];
+        p.trail_y[0] = p.trail_y[p.ntrail - 1];
+        p.ntrail = 1;
+      } else {
+        p.ntrail = 0;
       }
-      nsegs[showing] = 0;
-      hxs[showing][0] = hx;
-      hys[showing][0] = hy;
-      sum += 1;
-      Q->heat_inc = total_heat_per_frame / sum;
-    } else {
-      Raster(Q, hy, hx) = hot;
-      Q->heat_inc = total_heat_per_frame;
     }
+    if (sources)
+      sources->rasterize(Q, Q->heat_inc, total_heat_per_frame, !pipeline);
+    Q->update_heat_dirty();
+  }
+  uint64_t lapNs = stats.lap(PHASE_RASTER, nowNs);
+
+  if (pipeline) {
+    // Draw the newest snapshot, if there is one; the texture already
+    // shows the previous one.
+    pipeline->set_heat(Q);
+    const SimPipeline::Snapshot *s = pipeline->acquire();
+    if (s) {
+      GLubyte *tex = beginTexture();
+      tiles.plan_changed(s->changed_at, t);
+      t = s->t;
+      renderTexture(s->Q, t, tex, false);
+      lapNs = stats.lap(PHASE_CONVERT, lapNs);
+      uploadTexture();
+      stats.lap(PHASE_UPLOAD, lapNs);
+    }
+    mLastFrameNs = nowNs;
+    return;
   }
 
-  // TODO: Add logic and UI to select algorithm to run.
-//  Q->rect_null(t, t + Q->TStep, 0, Q->X, 0, Q->Y);
-  if (mLastFrameNs > 0) {
-    int tstep = int(float(nowNs - mLastFrameNs) * REAL_TIME_PER_TSTEP);
-    tstep = min(max(1, tstep), DEFAULT_TSTEP);
-//    ALOGV("tstep %d\n", tstep);
-//    rect_loops_serial(Q, t, t + tstep, 0, Q->X, 0, Q->Y);
-//    rect_loops_parallel(Q, t, t + tstep, 0, Q->X, 0, Q->Y);
-//    rect_recursive_serial(Q, t, t + tstep, 0, Q->X, 0, Q->Y);
-    rect_recursive_dp_ucut(Q, t, t + tstep, 0, Q->X, 0, Q->Y);
+  frameSteps = 0;
+  frameStencilNs = 0;
+  int tstep = mLastFrameNs > 0 ? budget.plan(nowNs - mLastFrameNs, double(Q->X) * Q->Y) : 0;
+  // The algorithms that compute through the row kernels flag the tiles
+  // whose codes change as they compute the last timestep; without a step,
+  // nothing changes.
+  ChangeSink changes = tiles.track(t + tstep);
+  bool tracked = tstep == 0 || (algorithm->flags & ALG_FUSED_OUTPUT);
+  if (tstep > 0) {
+    frameSteps = tstep;
+    Q->changes = tracked ? &changes : nullptr;
+    if (fusedOutput && (algorithm->flags & ALG_FUSED_OUTPUT)) {
+      // The base cases write the texels of the last timestep as they
+      // compute it, so renderTexture need not read the grid again.
+      GLubyte *tex = beginTexture();
+      OutputSink sink = {t + tstep, outputFormat(texFormat), tex, texelBytes() * Q->Xsep};
+      Q->output = &sink;
+      algorithm->fn(Q, t, t + tstep, 0, Q->X, 0, Q->Y);
+      Q->output = nullptr;
+      Q->changes = nullptr;
+      uint64_t doneNs = now_ns();
+      frameStencilNs = doneNs - lapNs;
+      stats.record_stencil(frameStencilNs, double(Q->X) * Q->Y * tstep);
+      t += tstep;
+      tiles.convert_all();
+      padTexture(Q, t, tex);
+      uploadTexture();
+      stats.lap(PHASE_UPLOAD, doneNs);
+      mLastFrameNs = nowNs;
+      return;
+    }
+    algorithm->fn(Q, t, t + tstep, 0, Q->X, 0, Q->Y);
+    Q->changes = nullptr;
+    uint64_t doneNs = now_ns();
+    frameStencilNs = doneNs - lapNs;
+    stats.record_stencil(frameStencilNs, double(Q->X) * Q->Y * tstep);
+    lapNs = doneNs;
     t += tstep;
   }
 
   // render
-  renderTexture();
+  GLubyte *tex = beginTexture();
+  tiles.plan(tracked);
+  renderTexture(Q, t, tex, true);
+  lapNs = stats.lap(PHASE_CONVERT, lapNs);
+  uploadTexture();
+  stats.lap(PHASE_UPLOAD, lapNs);
+
+  mLastFrameNs = nowNs;
+}
+
+void Renderer::syncPipeline() {
+  if (pipelined && !pipeline) {
+    pipeline = new SimPipeline(Q, t, algorithm);
+  } else if (!pipelined && pipeline) {
+    t = pipeline->finish(Q);
+    delete pipeline;
+    pipeline = nullptr;
+    budget.reset();
+  }
+}
+
+// GL formats of f: sized internal formats on ES3, as glTexStorage2D needs,
+// where TEX_LUMINANCE becomes the equivalent R8.
+static void texFormatGL(TexFormat f, bool es3, GLenum *internalFormat, GLenum *format,
+                        GLenum *type) {
+  switch (f) {
+    case TEX_R16F:
+      *internalFormat = GL_R16F, *format = GL_RED, *type = GL_HALF_FLOAT;
+      break;
+    case TEX_R32F:
+      *internalFormat = GL_R32F, *format = GL_RED, *type = GL_FLOAT;
+      break;
+    case TEX_LUMINANCE:
+      *internalFormat = es3 ? GL_R8 : GL_LUMINANCE;
+      *format = es3 ? GL_RED : GL_LUMINANCE;
+      *type = GL_UNSIGNED_BYTE;
+      break;
+    default:
+      *internalFormat = es3 ? GL_RGBA8 : GL_RGBA, *format = GL_RGBA, *type = GL_UNSIGNED_BYTE;
+      break;
+  }
+}
 
+void Renderer::allocTexture() {
+  GLenum internalFormat, format, type;
+  texFormatGL(texFormat, es3, &internalFormat, &format, &type);
+  if (es3) {
+    glDeleteTextures(1, &texName);
+    glGenTextures(1, &texName);
+  }
   glBindTexture(GL_TEXTURE_2D, texName);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, Q->Xsep, Q->Ysep, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, texImage);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  // ES3 can filter R32F textures only with OES_texture_float_linear.
+  GLint filter = texFormat == TEX_R32F ? GL_NEAREST : GL_LINEAR;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  if (es3)
+    glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, Q->Xsep, Q->Ysep);
+  else
+    glTexImage2D(GL_TEXTURE_2D, 0, GLint(internalFormat), Q->Xsep, Q->Ysep, 0, format, type,
+                 nullptr);
+  texW = Q->Xsep;
+  texH = Q->Ysep;
+  texAllocFormat = texFormat;
+  // The new storage holds nothing yet.
+  tiles.invalidate();
+  ALOGV("Texture %s, %d by %d\n", tex_format_name(texFormat), texW, texH);
+}
 
-  mLastFrameNs = nowNs;
+GLubyte *Renderer::beginTexture() {
+  if (texW != Q->Xsep || texH != Q->Ysep || texAllocFormat != texFormat)
+    allocTexture();
+  if (!es3)
+    return texImage;
+  size_t bytes = texelBytes() * Q->cells();
+  if (!pbo[0])
+    glGenBuffers(2, pbo);
+  if (pboBytes < bytes) {
+    // Grow-only, like texImage, so that resizing rarely reallocates.
+    pboBytes = bytes + size_t(bytes * RESHAPE_SLACK);
+    for (GLuint b : pbo) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(pboBytes), nullptr, GL_STREAM_DRAW);
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[pboNext]);
+  // Invalidating lets the driver hand out fresh memory rather than wait
+  // for an upload still reading this buffer.
+  auto *p = (GLubyte *) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(bytes),
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  if (!p) {
+    checkGlError("glMapBufferRange");
+    return texImage;
+  }
+  pboMapped = true;
+  return p;
+}
+
+void Renderer::uploadTexture() {
+  GLenum internalFormat, format, type;
+  texFormatGL(texFormat, es3, &internalFormat, &format, &type);
+  glBindTexture(GL_TEXTURE_2D, texName);
+  // Texture rows are Xsep texels, and Xsep is even.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  if (pboMapped) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[pboNext]);
+    pboMapped = false;
+    pboNext ^= 1;
+    // The contents are undefined if the buffer was corrupted while mapped;
+    // the next frame replaces them anyway.
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    uploadTiles(0, format, type);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  } else {
+    uploadTiles(uintptr_t(texImage), format, type);
+  }
+}
+
+void Renderer::uploadTiles(uintptr_t buf, GLenum format, GLenum type) {
+  int nx = tiles.tiles_x(), ny = tiles.tiles_y();
+  int changed = 0;
+  for (int i = 0; i < tiles.count(); ++i)
+    changed += tiles.action(i) != DirtyTiles::TILE_SKIP;
+  if (changed == 0)
+    return;
+  if (changed == tiles.count()) {
+    // One upload, which also covers the rows and columns past Y and X.
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Q->Xsep, Q->Ysep, format, type,
+                    (const GLvoid *) buf);
+    return;
+  }
+
+  // ES2 has no GL_UNPACK_ROW_LENGTH, so there a run is a whole row of
+  // tiles, uploaded Xsep texels wide as it is stored.  Runs that reach the
+  // last column or row of tiles also take the padding past X or Y, which
+  // the sampler filters into the edge.
+  size_t texel = texelBytes();
+  if (es3)
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, Q->Xsep);
+  // Pending rectangle of tiles [px0, px1) x [py0, py1); empty if py0 == py1.
+  int px0 = 0, px1 = 0, py0 = 0, py1 = 0;
+  auto flush = [&]() {
+    if (py0 == py1)
+      return;
+    int x0 = es3 ? px0 * DIRTY_TILE : 0;
+    int x1 = es3 && px1 < nx ? px1 * DIRTY_TILE : Q->Xsep;
+    int y0 = py0 * DIRTY_TILE, y1 = py1 < ny ? py1 * DIRTY_TILE : Q->Ysep;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0, y1 - y0, format, type,
+                    (const GLvoid *) (buf + texel * (size_t(y0) * Q->Xsep + x0)));
+    py0 = py1;
+  };
+  for (int ty = 0; ty < ny; ++ty) {
+    const int row = ty * nx;
+    for (int tx = 0; tx < nx;) {
+      if (tiles.action(row + tx) == DirtyTiles::TILE_SKIP) {
+        ++tx;
+        continue;
+      }
+      int tx0 = tx;
+      if (es3) {
+        while (tx < nx && tiles.action(row + tx) != DirtyTiles::TILE_SKIP)
+          ++tx;
+      } else {
+        tx0 = 0;
+        tx = nx;
+      }
+      if (py1 == ty && px0 == tx0 && px1 == tx) {
+        py1 = ty + 1;
+        continue;
+      }
+      flush();
+      px0 = tx0;
+      px1 = tx;
+      py0 = ty;
+      py1 = ty + 1;
+    }
+  }
+  flush();
+  if (es3)
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+void Renderer::initColormap() {
+  GLubyte lut[COLORMAP_SIZE * 4];
+  fill_colormap(lut);
+  glGenTextures(1, &lutName);
+  glBindTexture(GL_TEXTURE_2D, lutName);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, COLORMAP_SIZE, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               lut);
+
+  glUseProgram(mProgram);
+  glUniform1i(glGetUniformLocation(mProgram, "ourTexture"), 0);
+  glUniform1i(glGetUniformLocation(mProgram, "lut"), 1);
+  lutScaleLoc = glGetUniformLocation(mProgram, "lutScale");
+}
+
+void Renderer::bindTextures() const {
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, lutName);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texName);
+  // Maps the texture's value to the palette: the temperature u goes to
+  // u / 2, and TEX_LUMINANCE already holds that.  0 skips the palette.
+  float scale = texFormat == TEX_RGBA ? 0.0f : texFormat == TEX_LUMINANCE ? 1.0f : 0.5f;
+  glUniform1f(lutScaleLoc, scale);
 }
 
 void Renderer::render() {
+  uint64_t startNs = now_ns();
   step();
 
+  uint64_t drawNs = now_ns();
   glClearColor(0.2f, 0.2f, 0.3f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   draw();
+  stats.lap(PHASE_DRAW, drawNs);
+  uint64_t frameNs = stats.lap(PHASE_FRAME, startNs) - startNs;
+  if (Q && !pipeline)
+    budget.record(frameSteps, double(Q->X) * Q->Y, frameStencilNs, frameNs - frameStencilNs);
 
   checkGlError("Renderer::render");
 }
@@ -263,6 +566,15 @@ void Renderer::render() {
 // ----------------------------------------------------------------------------
 
 static Renderer *g_renderer = nullptr;
+// Algorithm selection, kept across renderer re-creation.
+static const Algorithm *g_algorithm = default_algorithm();
+// Persistent heat sources, likewise.
+static HeatSources g_sources;
+static TexFormat g_tex_format = TEX_R16F;
+static bool g_pipelined = false;
+static bool g_fused = false;
+static WalkParams g_walk;
+static uint64_t g_deadline_ns = DEFAULT_DEADLINE_NS;
 
 #if !defined(DYNAMIC_ES3)
 
@@ -291,7 +603,15 @@ JNIEXPORT void JNICALL Java_com_example_cilkheatdemo2_GLES3JNILib_init([[maybe_u
   } else {
     ALOGE("Unsupported OpenGL ES version");
   }
-
+  if (g_renderer) {
+    g_renderer->setAlgorithm(g_algorithm);
+    g_renderer->setSources(&g_sources);
+    g_renderer->setTexFormat(g_tex_format);
+    g_renderer->setPipelined(g_pipelined);
+    g_renderer->setFusedOutput(g_fused);
+    g_renderer->setWalkParams(g_walk);
+    g_renderer->setFrameDeadline(g_deadline_ns);
+  }
 }
 JNIEXPORT void JNICALL Java_com_example_cilkheatdemo2_GLES3JNILib_resize(
     [[maybe_unused]] JNIEnv *env, [[maybe_unused]] jclass obj, jint width, jint height) {
@@ -309,14 +629,273 @@ JNIEXPORT void JNICALL
 Java_com_example_cilkheatdemo2_GLES3JNILib_setXY([[maybe_unused]] JNIEnv *env,
                                                  [[maybe_unused]] jclass obj, jfloat x, jfloat y) {
   if (g_renderer) {
-    g_renderer->touchXY(x, y);
+    g_renderer->touchXY(0, x, y);
   }
 }
 JNIEXPORT void JNICALL
 Java_com_example_cilkheatdemo2_GLES3JNILib_clearXY([[maybe_unused]] JNIEnv *env,
                                                    [[maybe_unused]] jclass obj) {
   if (g_renderer) {
-    g_renderer->releaseXY();
+    g_renderer->releaseXY(0);
+  }
+}
+JNIEXPORT void JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_setPointer([[maybe_unused]] JNIEnv *env,
+                                                      [[maybe_unused]] jclass obj, jint id,
+                                                      jfloat x, jfloat y) {
+  if (g_renderer) {
+    g_renderer->touchXY(id, x, y);
+  }
+}
+JNIEXPORT void JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_clearPointer([[maybe_unused]] JNIEnv *env,
+                                                        [[maybe_unused]] jclass obj, jint id) {
+  if (g_renderer) {
+    g_renderer->releaseXY(id);
+  }
+}
+JNIEXPORT jboolean JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_setSource(JNIEnv *env,
+                                                     [[maybe_unused]] jclass obj,
+                                                     jstring name, jfloat x, jfloat y,
+                                                     jfloat radius, jfloat intensity,
+                                                     jstring shape) {
+  const char *shape_str = env->GetStringUTFChars(shape, nullptr);
+  SourceShape s;
+  bool found = find_source_shape(shape_str, &s);
+  if (!found) {
+    ALOGE("Unknown source shape %s\n", shape_str);
+  }
+  env->ReleaseStringUTFChars(shape, shape_str);
+  if (!found) {
+    return JNI_FALSE;
+  }
+  const char *str = env->GetStringUTFChars(name, nullptr);
+  g_sources.set(str, x, y, radius, intensity, s);
+  env->ReleaseStringUTFChars(name, str);
+  return JNI_TRUE;
+}
+JNIEXPORT jboolean JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_removeSource(JNIEnv *env,
+                                                        [[maybe_unused]] jclass obj,
+                                                        jstring name) {
+  const char *str = env->GetStringUTFChars(name, nullptr);
+  bool removed = g_sources.remove(str);
+  env->ReleaseStringUTFChars(name, str);
+  return removed ? JNI_TRUE : JNI_FALSE;
+}
+JNIEXPORT jboolean JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_setTextureFormat(JNIEnv *env,
+                                                            [[maybe_unused]] jclass obj,
+                                                            jstring name) {
+  const char *str = env->GetStringUTFChars(name, nullptr);
+  TexFormat f;
+  bool found = find_tex_format(str, &f);
+  if (!found) {
+    ALOGE("Unknown texture format %s\n", str);
+  }
+  env->ReleaseStringUTFChars(name, str);
+  if (!found) {
+    return JNI_FALSE;
+  }
+  g_tex_format = f;
+  if (g_renderer) {
+    g_renderer->setTexFormat(f);
+  }
+  return JNI_TRUE;
+}
+JNIEXPORT void JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_setPipelined([[maybe_unused]] JNIEnv *env,
+                                                        [[maybe_unused]] jclass obj,
+                                                        jboolean on) {
+  g_pipelined = on;
+  if (g_renderer) {
+    g_renderer->setPipelined(on);
+  }
+}
+JNIEXPORT void JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_setFusedColormap([[maybe_unused]] JNIEnv *env,
+                                                            [[maybe_unused]] jclass obj,
+                                                            jboolean on) {
+  g_fused = on;
+  if (g_renderer) {
+    g_renderer->setFusedOutput(on);
+  }
+}
+JNIEXPORT jintArray JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_autotune(JNIEnv *env,
+                                                    [[maybe_unused]] jclass obj,
+                                                    jstring path, jstring algorithm,
+                                                    jboolean retune) {
+  const char *name = env->GetStringUTFChars(algorithm, nullptr);
+  const Algorithm *a = find_algorithm(name);
+  if (!a) {
+    ALOGE("Unknown algorithm %s\n", name);
+  }
+  env->ReleaseStringUTFChars(algorithm, name);
+  if (!a) {
+    return nullptr;
+  }
+  const char *file = env->GetStringUTFChars(path, nullptr);
+  TuneOptions opts;
+  // The app tunes while the view is shown, so bound how long the search
+  // competes with the renderer for the cores.  A search cut short is not
+  // saved, so the next launch tunes again; its best cutoffs apply until
+  // then.
+  opts.budget_ns = APP_TUNE_BUDGET_NS;
+  WalkParams p;
+  if (!tuned_walk_params(file, a, opts, retune, &p)) {
+    ALOGE("Could not save the tuned cutoffs to %s\n", file);
+  }
+  ALOGV("%s on %s: x_stop %d y_stop %d dt_stop %d lt_thresh %d coarsen %d\n", a->name,
+        device_fingerprint().c_str(), p.x_stop, p.y_stop, p.dt_stop, p.lt_thresh, p.coarsen);
+  env->ReleaseStringUTFChars(path, file);
+  jint values[5] = {p.x_stop, p.y_stop, p.dt_stop, p.lt_thresh, p.coarsen};
+  jintArray result = env->NewIntArray(5);
+  env->SetIntArrayRegion(result, 0, 5, values);
+  return result;
+}
+JNIEXPORT jboolean JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_setWalkParams(JNIEnv *env,
+                                                         [[maybe_unused]] jclass obj,
+                                                         jintArray params) {
+  if (!params || env->GetArrayLength(params) != 5) {
+    return JNI_FALSE;
+  }
+  jint v[5];
+  env->GetIntArrayRegion(params, 0, 5, v);
+  WalkParams p;
+  p.x_stop = v[0];
+  p.y_stop = v[1];
+  p.dt_stop = v[2];
+  p.lt_thresh = v[3];
+  p.coarsen = v[4];
+  if (!valid_walk_params(p)) {
+    ALOGE("Invalid walker cutoffs\n");
+    return JNI_FALSE;
+  }
+  g_walk = p;
+  if (g_renderer) {
+    g_renderer->setWalkParams(p);
+  }
+  return JNI_TRUE;
+}
+JNIEXPORT jintArray JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_getWalkParams(JNIEnv *env,
+                                                         [[maybe_unused]] jclass obj) {
+  jint values[5] = {g_walk.x_stop, g_walk.y_stop, g_walk.dt_stop, g_walk.lt_thresh,
+                    g_walk.coarsen};
+  jintArray result = env->NewIntArray(5);
+  env->SetIntArrayRegion(result, 0, 5, values);
+  return result;
+}
+JNIEXPORT void JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_setFrameDeadline([[maybe_unused]] JNIEnv *env,
+                                                            [[maybe_unused]] jclass obj,
+                                                            jfloat ms) {
+  g_deadline_ns = ms > 0 ? uint64_t(double(ms) * 1e6) : 0;
+  if (g_renderer) {
+    g_renderer->setFrameDeadline(g_deadline_ns);
+  }
+}
+JNIEXPORT jfloat JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_getFrameDeadline([[maybe_unused]] JNIEnv *env,
+                                                            [[maybe_unused]] jclass obj) {
+  return jfloat(double(g_deadline_ns) * 1e-6);
+}
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_getPipelineStats(JNIEnv *env,
+                                                            [[maybe_unused]] jclass obj) {
+  SimPipeline::Stats st = g_renderer ? g_renderer->pipelineStats() : SimPipeline::Stats{};
+  jfloat values[6] = {st.age_ms, st.age_max_ms, st.input_ms, st.input_max_ms,
+                      jfloat(st.published), jfloat(st.acquired)};
+  jfloatArray result = env->NewFloatArray(6);
+  env->SetFloatArrayRegion(result, 0, 6, values);
+  return result;
+}
+JNIEXPORT jobjectArray JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_getFramePhases(JNIEnv *env,
+                                                          [[maybe_unused]] jclass obj) {
+  jobjectArray names = env->NewObjectArray(NUM_PHASES, env->FindClass("java/lang/String"),
+                                           nullptr);
+  for (int i = 0; i < NUM_PHASES; i++) {
+    jstring name = env->NewStringUTF(phase_name(FramePhase(i)));
+    env->SetObjectArrayElement(names, i, name);
+    env->DeleteLocalRef(name);
+  }
+  return names;
+}
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_getFrameStats(JNIEnv *env,
+                                                         [[maybe_unused]] jclass obj) {
+  // p50, p95, p99 and sample count of each phase, then cells/s.
+  jfloat values[4 * NUM_PHASES + 1] = {};
+  if (g_renderer) {
+    const FrameStats &stats = g_renderer->frameStats();
+    for (int i = 0; i < NUM_PHASES; i++) {
+      FrameStats::Summary s = stats.summary(FramePhase(i));
+      values[4 * i] = s.p50_ms;
+      values[4 * i + 1] = s.p95_ms;
+      values[4 * i + 2] = s.p99_ms;
+      values[4 * i + 3] = jfloat(s.samples);
+    }
+    values[4 * NUM_PHASES] = jfloat(stats.cells_per_second());
+  }
+  jfloatArray result = env->NewFloatArray(4 * NUM_PHASES + 1);
+  env->SetFloatArrayRegion(result, 0, 4 * NUM_PHASES + 1, values);
+  return result;
+}
+JNIEXPORT void JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_clearSources([[maybe_unused]] JNIEnv *env,
+                                                        [[maybe_unused]] jclass obj) {
+  g_sources.clear();
+}
+JNIEXPORT jobjectArray JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_getAlgorithms(JNIEnv *env,
+                                                         [[maybe_unused]] jclass obj) {
+  // Experimental algorithms compute the wrong field; they stay in the
+  // registry for heat_bench but are not offered to the app.
+  int n = 0;
+  for (int i = 0; i < num_algorithms; i++) {
+    if (!(algorithms[i].flags & ALG_EXPERIMENTAL))
+      n++;
+  }
+  jobjectArray names = env->NewObjectArray(n, env->FindClass("java/lang/String"), nullptr);
+  for (int i = 0, j = 0; i < num_algorithms; i++) {
+    if (algorithms[i].flags & ALG_EXPERIMENTAL)
+      continue;
+    jstring name = env->NewStringUTF(algorithms[i].name);
+    env->SetObjectArrayElement(names, j++, name);
+    env->DeleteLocalRef(name);
+  }
+  return names;
+}
+JNIEXPORT jstring JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_getAlgorithm(JNIEnv *env,
+                                                        [[maybe_unused]] jclass obj) {
+  return env->NewStringUTF(g_algorithm->name);
+}
+JNIEXPORT jboolean JNICALL
+Java_com_example_cilkheatdemo2_GLES3JNILib_setAlgorithm(JNIEnv *env,
+                                                        [[maybe_unused]] jclass obj,
+                                                        jstring name) {
+  const char *str = env->GetStringUTFChars(name, nullptr);
+  const Algorithm *a = find_algorithm(str);
+  if (!a) {
+    ALOGE("Unknown algorithm %s\n", str);
+  } else if (a->flags & ALG_EXPERIMENTAL) {
+    ALOGE("Algorithm %s is experimental and inexact\n", str);
+    a = nullptr;
+  }
+  env->ReleaseStringUTFChars(name, str);
+  if (!a) {
+    return JNI_FALSE;
+  }
+  ALOGV("Using algorithm %s\n", a->name);
+  g_algorithm = a;
+  if (g_renderer) {
+    g_renderer->setAlgorithm(a);
   }
+  return JNI_TRUE;
 }
 };
@@ -20,8 +20,19 @@
 
 #include <android/log.h>
 #include <cmath>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 #include "common.h"
 #include "sim.h"
+#include "algorithms.h"
+#include "dirty_tiles.h"
+#include "frame_stats.h"
+#include "heat_sources.h"
+#include "sim_pipeline.h"
+#include "sim_resize.h"
+#include "step_budget.h"
+#include "touch_ring.h"
 
 #if DYNAMIC_ES3
 #include "gl3stub.h"
@@ -68,6 +79,42 @@ extern GLuint createShader(GLenum shaderType, const char *src);
 
 extern GLuint createProgram(const char *vtxSrc, const char *fragSrc);
 
+// Format of the texture uploaded every frame.  TEX_RGBA is colored by
+// renderTexture on the CPU; the others hold the temperature in a single
+// channel and are colored by the fragment shader through a palette texture.
+enum TexFormat {
+  TEX_RGBA,       // 4 bytes per cell.
+  TEX_R16F,       // 2 bytes per cell; ES3 only.
+  TEX_R32F,       // 4 bytes per cell, not filtered; ES3 only.
+  TEX_LUMINANCE,  // 1 byte per cell, the temperature quantized as 255 (u / 2).
+  NUM_TEX_FORMATS
+};
+
+static inline const char *tex_format_name(TexFormat f) {
+  switch (f) {
+    case TEX_RGBA: return "rgba";
+    case TEX_R16F: return "r16f";
+    case TEX_R32F: return "r32f";
+    case TEX_LUMINANCE: return "luminance";
+    default: return "unknown";
+  }
+}
+
+// Sets *f to the format called name; returns false if there is none.
+static inline bool find_tex_format(const char *name, TexFormat *f) {
+  for (int i = 0; i < NUM_TEX_FORMATS; ++i) {
+    if (strcmp(name, tex_format_name(TexFormat(i))) == 0) {
+      *f = TexFormat(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+static inline bool tex_format_needs_es3(TexFormat f) {
+  return f == TEX_R16F || f == TEX_R32F;
+}
+
 // ----------------------------------------------------------------------------
 // Interface to the ES2 and ES3 renderers, used by JNI code.
 
@@ -79,22 +126,81 @@ public:
 
   void render();
 
-  void touchXY(float x, float y) {
+  // Called from the UI thread; the events are applied by step().
+  void touchXY(int id, float x, float y) {
+    touches.push({id, x, y, false});
+  }
+
+  void releaseXY(int id) {
+    touches.push({id, 0, 0, true});
+  }
+
+  // Sources drawn every frame in addition to the touches.  Must be called
+  // on the GL thread.
+  void setSources(HeatSources *s) {
+    sources = s;
+  }
+
+  void setAlgorithm(const Algorithm *a) {
+    algorithm = a;
+    budget.reset();
+    if (pipeline)
+      pipeline->set_algorithm(a);
+  }
+
+  // Runs the simulation on a thread of its own (see SimPipeline) instead
+  // of in step(), which then draws the newest snapshot.  Must be called on
+  // the GL thread.
+  void setPipelined(bool on) {
+    pipelined = on;
+    if (Q)
+      syncPipeline();
+  }
+
+  // Has the algorithm convert the last timestep of each frame to texels
+  // as it computes it (see SimState::output), when it can and the
+  // simulation runs in step().  Every tile is then uploaded.
+  void setFusedOutput(bool on) {
+    fusedOutput = on;
+  }
+
+  // Cutoffs of the walkers (see autotune.h), from the next step on.  A
+  // running pipeline is restarted to pick them up.  Must be called on the
+  // GL thread.
+  void setWalkParams(const WalkParams &p) {
+    walk = p;
     if (!Q)
       return;
-    hot = 1;
-    hx = int(x * Xscale);
-    hy = int(y * Yscale);
-    hx = min(max(hx, 0), Q->X - 1);
-    hy = min(max(hy, 0), Q->Y - 1);
-    // record the trail of mouse
-    hxs[recording][nsegs[recording]] = hx;
-    hys[recording][nsegs[recording]] = hy;
-    nsegs[recording]++;
+    Q->walk = p;
+    budget.reset();
+    if (pipeline) {
+      pipelined = false;
+      syncPipeline();
+      pipelined = true;
+      syncPipeline();
+    }
+  }
+
+  // Deadline that step() fits the frame's timesteps into (see StepBudget),
+  // in nanoseconds; 0 runs whatever real time calls for.
+  void setFrameDeadline(uint64_t ns) {
+    budget.set_deadline(ns);
   }
 
-  void releaseXY() {
-    hot = 0;
+  // Latencies of the pipeline; zero if it is not running.
+  SimPipeline::Stats pipelineStats() {
+    return pipeline ? pipeline->stats() : SimPipeline::Stats{};
+  }
+
+  // Phase timings of the recent frames.  Must be called on the GL thread.
+  const FrameStats &frameStats() const {
+    return stats;
+  }
+
+  // Formats that need ES3 fall back to TEX_LUMINANCE on ES2.  Must be
+  // called on the GL thread.
+  void setTexFormat(TexFormat f) {
+    texFormat = !es3 && tex_format_needs_es3(f) ? TEX_LUMINANCE : f;
   }
 
 protected:
@@ -103,55 +209,261 @@ protected:
   };
   GLuint mProgram;
   GLuint texName;
+  // Palette of the single-channel formats: COLORMAP_SIZE RGBA texels (see
+  // fill_colormap).
+  GLuint lutName = 0;
+  GLint lutScaleLoc = -1;
   GLubyte *texImage = nullptr;
+  size_t texImageBytes = 0;  // Allocated; grows only.
+  GLubyte *padRow = nullptr;  // A row of texels for padTexture.
+  bool es3 = false;
+  TexFormat texFormat = TEX_R16F;
+  // Size and format of texName's storage; ES3 allocates it immutably with
+  // glTexStorage2D, so a change makes a new texture.
+  int texW = 0, texH = 0;
+  TexFormat texAllocFormat = NUM_TEX_FORMATS;
+  // ES3: pixel unpack buffers that renderTexture fills in turn, so that
+  // filling one never waits for the upload from the other to finish.
+  GLuint pbo[2]{};
+  size_t pboBytes = 0;
+  int pboNext = 0;
+  bool pboMapped = false;
   GLuint mVB[VB_COUNT]{};
   GLuint mVBState;
 
   SimState *Q = nullptr;
   long t = 0;
+  // Stencil algorithm run by step().
+  const Algorithm *algorithm = default_algorithm();
+  // Layout of Q's time planes; separate planes measured fastest with the
+  // row kernels (see heat_bench -L).
+  SimLayout layout = LAYOUT_TIME_OUTER;
+  // Precision of Q; the grid is only shown as 8-bit color, which float
+  // reproduces exactly in practice (see heat_bench -E).
+  SimPrecision precision = PREC_FLOAT;
 
   // used to scale window size to grid size
   const float MUL = 2.8 * 2;
   // used to map window coordinates to grid coordinates
   float Xscale = 1, Yscale = 1;
 
-  int hot = 0;
-
-  // Jim: This display code I think makes some assumption of the size of the
-  // window that is it less than a certain size?  This part needs to be fixed to
-  // handle more general grids.
-  int hx = 0, hy = 0;              // current heat source location
-  int hxs[2][1024]{}, hys[2][1024]{};  // heat source trail
-  int nsegs[2] = {0, 0};    // heat source trail #segments
-  int recording = 0;  // which trail are we recording.  here we use a double buffer trick.
+  // Touch events from the UI thread, drained once per frame by step().
+  static constexpr int LG_TOUCHES = 10;
+  TouchQueue<LG_TOUCHES> touches;
+  int hx = 0, hy = 0;              // last touched location
+  // Heat source trail of each pointer in the current frame, in grid
+  // coordinates.  While the pointer is held, trail[0] is the last point of
+  // the previous frame, so the trail has no gaps between frames; a release
+  // followed by a new touch in the same frame is separated by a point at
+  // x = -1.
+  struct Pointer {
+    int trail_x[TouchQueue<LG_TOUCHES>::Capacity + 1];
+    int trail_y[TouchQueue<LG_TOUCHES>::Capacity + 1];
+    int ntrail;
+    bool down;
+  };
+  Pointer pointers[MAX_POINTERS]{};
+  // Persistent sources, or nullptr.
+  HeatSources *sources = nullptr;
+  // Level written by draw_pixel.
+  char draw_level = 0;
   const float total_heat_per_frame = 0.2;
+  // Tiles of the texture that need converting and uploading this frame.
+  DirtyTiles tiles;
+  // Simulation thread, while pipelined; Q then holds only the raster, and
+  // t is the time of the snapshot shown.
+  bool pipelined = false;
+  SimPipeline *pipeline = nullptr;
+  bool fusedOutput = false;
+  WalkParams walk;
+  // Timesteps of each frame that step() runs itself, and what the last
+  // one ran and how long that took.
+  StepBudget budget;
+  // Holds the old grid's values while a resize remaps them.
+  ResizeScratch resizeScratch;
+  int frameSteps = 0;
+  uint64_t frameStencilNs = 0;
+  // Timings of render() and its phases.  Pipelined, the stencil runs on
+  // the simulation thread and is not timed here.
+  FrameStats stats;
 
   Renderer();
 
   virtual void draw() = 0;
 
+  // Creates lutName and points the program's samplers at texture units 0
+  // (the grid) and 1 (the palette).  Called by init().
+  void initColormap();
+
+  // Binds the grid and palette textures and sets the program's lutScale.
+  void bindTextures() const;
+
 private:
   void calcSceneParams(unsigned int w, unsigned int h);
 
   void step();
 
+  // Starts or stops the pipeline to match pipelined.
+  void syncPipeline();
+
   uint64_t mLastFrameNs;
 
-  void renderTexture() const {
-    int GridX = Q->X, GridY = Q->Y;
-    cilk_for(int x = 0; x < GridX; x++) {
-      cilk_for(int y = 0; y < GridY; y++) {
-//      ALOGV("x %d, y %d, TexImage() = %p..%p\n", x, y, &TexImage(Q, y, x, 0), &TexImage(Q, y, x, 3));
-        TexImage(Q, x, y, 0) = min(0xFF, 0xFF * U(Q, 0, x, y));
-        TexImage(Q, x, y, 1) = min(0xFF, 0xFF * (0.5 * U(Q, 0, x, y)));
-        TexImage(Q, x, y, 2) = min(0xFF, 0xFF * (1 - 0.8 * U(Q, 0, x, y)));
-        TexImage(Q, x, y, 3) = 1;
+  // Converts the tiles of S's grid at time that tiles planned to convert
+  // or check to texels in texFormat at tex, which has rows of Xsep texels,
+  // as returned by beginTexture.  Each strand takes one tile; the other
+  // tiles of tex are left alone.  Serial unless parallel, so that a
+  // pipelined frame does not compete with the simulation thread for the
+  // workers.
+  void renderTexture(const SimState *S, long time, GLubyte *tex, bool parallel) {
+    TexFormat format = texFormat;
+    size_t texel = texelBytes();
+    size_t pitch = texel * size_t(S->Xsep);
+    DirtyTiles &D = tiles;
+    with_sim_view(S, [&](auto *V) {
+      typedef std::decay_t<decltype(*V)> View;
+      auto convert = [&](int i) {
+        DirtyTiles::Action action = D.action(i);
+        if (action == DirtyTiles::TILE_SKIP)
+          return;
+        int x0, x1, y0, y1;
+        D.cells(i, &x0, &x1, &y0, &y1);
+        if (action == DirtyTiles::TILE_CHECK) {
+          bool changed = false;
+          for (int y = y0; y < y1; ++y) {
+            V->row_spans(time, y, x0, x1, [&](int k, const auto *src, int n) {
+              changed |= D.template check_row<View::XStride>(x0 + k, y, src, n);
+            });
+          }
+          if (!changed) {
+            D.skip(i);
+            return;
+          }
+        }
+        for (int y = y0; y < y1; ++y) {
+          GLubyte *row = tex + pitch * y + texel * x0;
+          switch (format) {
+            case TEX_RGBA:
+              V->rgba_row(time, y, x0, x1, row);
+              break;
+            case TEX_R16F:
+              V->row_spans(time, y, x0, x1, [row](int k, const auto *src, int n) {
+                to_half<View::XStride>((uint16_t *) row + k, src, n);
+              });
+              break;
+            case TEX_R32F:
+              V->row_spans(time, y, x0, x1, [row](int k, const auto *src, int n) {
+                to_float<View::XStride>((float *) row + k, src, n);
+              });
+              break;
+            default:
+              V->row_spans(time, y, x0, x1, [row](int k, const auto *src, int n) {
+                to_luminance<View::XStride>(row + k, src, n);
+              });
+              break;
+          }
+        }
+      };
+      if (parallel) {
+        cilk_for (int i = 0; i < D.count(); ++i)
+          convert(i);
+      } else {
+        for (int i = 0; i < D.count(); ++i)
+          convert(i);
+      }
+    });
+    padTexture(S, time, tex);
+  }
+
+  // Fills the texels of tex past S's X columns and Y rows with copies of
+  // the last column and row at time.  The uploads send whole Xsep-wide
+  // rows, and the sampler filters across the border, so the padding must
+  // not be left undefined.  The edge texels are converted again into
+  // padRow rather than read back from tex, which may be a write-only PBO.
+  void padTexture(const SimState *S, long time, GLubyte *tex) {
+    size_t texel = texelBytes();
+    size_t pitch = texel * size_t(S->Xsep);
+    // A pitch of 0 sends every row to padRow.
+    OutputSink pad = {time, outputFormat(texFormat), padRow, 0};
+    GLubyte *edge = padRow + texel * (S->X - 1);
+    with_sim_view(S, [&](auto *V) {
+      if (S->X < S->Xsep) {
+        for (int y = 0; y < S->Y; ++y) {
+          V->output_row(&pad, time, y, S->X - 1, S->X);
+          GLubyte *row = tex + pitch * y;
+          for (int x = S->X; x < S->Xsep; ++x)
+            memcpy(row + texel * x, edge, texel);
+        }
       }
+      if (S->Y < S->Ysep) {
+        V->output_row(&pad, time, S->Y - 1, 0, S->X);
+        for (int x = S->X; x < S->Xsep; ++x)
+          memcpy(padRow + texel * x, edge, texel);
+        for (int y = S->Y; y < S->Ysep; ++y)
+          memcpy(tex + pitch * y, padRow, pitch);
+      }
+    });
+  }
+
+  static OutputFormat outputFormat(TexFormat f) {
+    switch (f) {
+      case TEX_R16F: return OUT_HALF;
+      case TEX_R32F: return OUT_FLOAT;
+      case TEX_LUMINANCE: return OUT_LUMINANCE;
+      default: return OUT_RGBA;
+    }
+  }
+
+  size_t texelBytes() const {
+    switch (texFormat) {
+      case TEX_R16F: return 2;
+      case TEX_LUMINANCE: return 1;
+      default: return 4;
+    }
+  }
+
+  // (Re)allocates texName's storage if Q's size or texFormat changed, and
+  // returns the buffer for renderTexture: the next PBO, mapped, on ES3, or
+  // texImage.
+  GLubyte *beginTexture();
+
+  // Uploads the tiles of the buffer returned by beginTexture that
+  // renderTexture wrote to texName.  From a PBO, glTexSubImage2D only
+  // queues the copy, which then overlaps the next simulation step.
+  void uploadTexture();
+
+  // Uploads the changed tiles from buf, a pointer into client memory or an
+  // offset into the bound PBO: runs of consecutive tiles in each row of
+  // tiles, a run joining the one above it when they span the same columns.
+  void uploadTiles(uintptr_t buf, GLenum format, GLenum type);
+
+  void allocTexture();
+
+  // Number of steps bres takes to draw p's trail.
+  static int trail_steps(const Pointer &p) {
+    int sum = 0;
+    for (int i = 0; i < p.ntrail - 1; i++) {
+      if (p.trail_x[i] < 0 || p.trail_x[i + 1] < 0)
+        continue;
+      sum += max(abs(p.trail_x[i + 1] - p.trail_x[i]), abs(p.trail_y[i + 1] - p.trail_y[i]));
+    }
+    return sum;
+  }
+
+  // Draws p's trail into the raster at draw_level.
+  void draw_trail(const Pointer &p) {
+    for (int i = 0; i < p.ntrail; i++) {
+      if (p.trail_x[i] < 0)
+        continue;
+      if (i + 1 < p.ntrail && p.trail_x[i + 1] >= 0)
+        bres(p.trail_x[i], p.trail_y[i], p.trail_x[i + 1], p.trail_y[i + 1]);
+      else if (i == 0 || p.trail_x[i - 1] < 0)
+        draw_pixel(p.trail_x[i], p.trail_y[i]);
     }
   }
 
   void draw_pixel(int x, int y) {
-    Raster(Q, y, x) = hot;
+    if (draw_level > Raster(Q, y, x))
+      Q->set_raster(x, y, draw_level);
   }
 
   int bres(int x1, int y1, int x2, int y2) {
@@ -0,0 +1,430 @@
+/* Host-side benchmark driver for the Cilk heat-diffusion demo.
+ *
+ * Builds the same SimState engine and rect_* entry points that back the
+ * Android renderer, runs a number of timesteps on an X by Y grid with a
+ * chosen algorithm and reports throughput in cells per second.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include "bench.h"
+
+#ifdef __cilk
+#include <cilk/cilk_api.h>
+#endif
+
+unsigned num_workers() {
+#ifdef __cilk
+  return __cilkrts_get_nworkers();
+#else
+  return 1;
+#endif
+}
+
+bool parse_int_list(const char *str, std::vector<int> &out) {
+  out.clear();
+  while (*str) {
+    char *end;
+    long v = strtol(str, &end, 10);
+    if (end == str || v <= 0 || (*end && *end != ','))
+      return false;
+    out.push_back(int(v));
+    str = *end ? end + 1 : end;
+  }
+  return !out.empty();
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-x X] [-y Y] [-t TSTEPS] [-a ALGORITHM] [-L LAYOUT] [-P PRECISION]\n"
+          "          [-H HEAT] [-r REPS] [-K FILE] [-l]\n"
+          "       %s -S [-g SIZES] [-t TSTEPS] [-w WORKERS] [-a ALGORITHMS] [-L LAYOUTS]\n"
+          "          [-P PRECISIONS] [-r REPS] [-j]\n"
+          "       %s -V [-n TRIALS] [-s SEED]\n"
+          "       %s -E [-x X] [-y Y] [-t TSTEPS] [-a ALGORITHM]\n"
+          "       %s -F FRAMES [-x X] [-y Y] [-t TSTEPS] [-a ALGORITHM] [-L LAYOUT]\n"
+          "          [-P PRECISION] [-C] [-D DEADLINE]\n"
+          "       %s -W [-x X] [-y Y] [-t TSTEPS] [-a ALGORITHMS] [-L LAYOUT] [-P PRECISION]\n"
+          "       %s -A FILE [-x X] [-y Y] [-t TSTEPS] [-a ALGORITHMS] [-L LAYOUT]\n"
+          "          [-P PRECISION] [-r REPS]\n"
+          "  -x X          grid width (default 1024)\n"
+          "  -y Y          grid height (default 1024)\n"
+          "  -t TSTEPS     timesteps per run (default %d; suite 1,5,32,%d)\n"
+          "  -a ALGORITHM  algorithm to run (default %s)\n"
+          "  -L LAYOUT     storage layout of the grid: inner, outer, blocked or\n"
+          "                blocked_outer (default inner; suite: all)\n"
+          "  -P PRECISION  storage and arithmetic: double, float, or mixed (float\n"
+          "                storage, double arithmetic) (default double)\n"
+          "  -H HEAT       how heat sources are applied: dense (read the raster on\n"
+          "                every cell), sparse (run-list) or auto (default)\n"
+          "  -r REPS       number of timed runs (default 3, suite 5)\n"
+          "  -l            list algorithms and exit\n"
+          "  -S            run the benchmark suite; -g, -t, -w, -a, -L and -P take\n"
+          "                comma-separated lists\n"
+          "  -g SIZES      square grid sizes (default 32,128,512,2048,4096)\n"
+          "  -w WORKERS    CILK_NWORKERS values (default 1,2,4,... up to the\n"
+          "                number of processors)\n"
+          "  -j            print suite results as JSON instead of CSV\n"
+          "  -V            verify every algorithm against loops_serial on\n"
+          "                randomized grids, patterns and time ranges\n"
+          "  -n TRIALS     number of verification trials (default 20)\n"
+          "  -s SEED       random seed for verification (default 1)\n"
+          "  -E            report the error of float and mixed precision against\n"
+          "                double after TSTEPS timesteps (default %d)\n"
+          "  -F FRAMES     replay the renderer's frames without GL, TSTEPS timesteps\n"
+          "                each, and print the p50/p95/p99 time of each phase and\n"
+          "                the stencil's cells/s\n"
+          "  -C            with -F, convert to texels inside the stencil's last\n"
+          "                timestep, as setFusedColormap does\n"
+          "  -D DEADLINE   with -F, choose each frame's timesteps to fit a frame\n"
+          "                deadline of DEADLINE ms, as the renderer does, instead\n"
+          "                of running TSTEPS\n"
+          "  -W            report work, span, parallelism and burdened parallelism\n"
+          "                of the parallel walkers (default: all of them); needs a\n"
+          "                build with -DHEAT_WALK_PROFILE=ON\n"
+          "  -A FILE       tune the walkers' cutoffs on this device (default: every\n"
+          "                exact walker that has any; layout outer, precision float) and\n"
+          "                save the best of each in FILE\n"
+          "  -K FILE       run with the cutoffs saved in FILE for this device, grid,\n"
+          "                algorithm, layout and precision\n",
+          argv0, argv0, argv0, argv0, argv0, argv0, argv0, DEFAULT_TSTEP, DEFAULT_TSTEP,
+          default_algorithm()->name,
+          20 * DEFAULT_TSTEP);
+}
+
+// Parses a comma-separated list of names of the values of an enum E with
+// count values, as returned by name_of.
+template<typename E>
+static bool parse_name_list(const char *str, std::vector<E> &out, int count,
+                            const char *(*name_of)(E)) {
+  std::string list(str);
+  out.clear();
+  size_t pos = 0;
+  while (pos <= list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos)
+      end = list.size();
+    std::string name = list.substr(pos, end - pos);
+    int i = 0;
+    while (i < count && name != name_of(E(i)))
+      ++i;
+    if (i == count)
+      return false;
+    out.push_back(E(i));
+    pos = end + 1;
+  }
+  return true;
+}
+
+bool parse_layout_list(const char *str, std::vector<SimLayout> &out) {
+  return parse_name_list(str, out, NUM_LAYOUTS, layout_name);
+}
+
+bool parse_precision_list(const char *str, std::vector<SimPrecision> &out) {
+  return parse_name_list(str, out, NUM_PRECISIONS, precision_name);
+}
+
+// Parses a comma-separated list of algorithm names.
+static bool parse_algorithm_list(const char *str, std::vector<const Algorithm *> &out) {
+  std::string list(str);
+  out.clear();
+  size_t pos = 0;
+  while (pos <= list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos)
+      end = list.size();
+    std::string name = list.substr(pos, end - pos);
+    const Algorithm *algo = find_algorithm(name.c_str());
+    if (!algo) {
+      fprintf(stderr, "unknown algorithm '%s' (use -l to list)\n", name.c_str());
+      return false;
+    }
+    out.push_back(algo);
+    pos = end + 1;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  int X = 1024, Y = 1024, reps = 0;
+  const char *heat = "auto";
+  bool suite = false, verify = false, precision_report = false, fused = false;
+  bool walk_report = false;
+  const char *tune_file = nullptr, *tuned_file = nullptr;
+  int frames = 0;
+  double deadline_ms = 0;
+  int trials = 20;
+  unsigned seed = 1;
+  SuiteOptions opts;
+  bool tsteps_set = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "x:y:t:a:L:P:H:r:lSg:w:jZVEn:s:F:CD:WA:K:h")) != -1) {
+    switch (opt) {
+      case 'x': X = atoi(optarg); break;
+      case 'y': Y = atoi(optarg); break;
+      case 't':
+        if (!parse_int_list(optarg, opts.tsteps)) {
+          fprintf(stderr, "invalid timestep count '%s'\n", optarg);
+          return 1;
+        }
+        tsteps_set = true;
+        break;
+      case 'a':
+        if (!parse_algorithm_list(optarg, opts.algos))
+          return 1;
+        break;
+      case 'L':
+        if (!parse_layout_list(optarg, opts.layouts)) {
+          fprintf(stderr, "invalid layouts '%s'\n", optarg);
+          return 1;
+        }
+        break;
+      case 'P':
+        if (!parse_precision_list(optarg, opts.precisions)) {
+          fprintf(stderr, "invalid precisions '%s'\n", optarg);
+          return 1;
+        }
+        break;
+      case 'H': heat = optarg; break;
+      case 'r': reps = atoi(optarg); break;
+      case 'l':
+        for (int i = 0; i < num_algorithms; ++i)
+          printf("%-24s %s\n", algorithms[i].name, algorithms[i].description);
+        return 0;
+      case 'S': suite = true; break;
+      case 'g':
+        if (!parse_int_list(optarg, opts.sizes)) {
+          fprintf(stderr, "invalid grid sizes '%s'\n", optarg);
+          return 1;
+        }
+        break;
+      case 'w':
+        if (!parse_int_list(optarg, opts.workers)) {
+          fprintf(stderr, "invalid worker counts '%s'\n", optarg);
+          return 1;
+        }
+        break;
+      case 'j': opts.json = true; break;
+      case 'Z': opts.child = true; break;
+      case 'V': verify = true; break;
+      case 'E': precision_report = true; break;
+      case 'n': trials = atoi(optarg); break;
+      case 's': seed = unsigned(strtoul(optarg, nullptr, 10)); break;
+      case 'F':
+        frames = atoi(optarg);
+        if (frames < 1) {
+          fprintf(stderr, "invalid frame count '%s'\n", optarg);
+          return 1;
+        }
+        break;
+      case 'C': fused = true; break;
+      case 'D':
+        deadline_ms = atof(optarg);
+        if (!(deadline_ms > 0)) {
+          fprintf(stderr, "invalid deadline '%s'\n", optarg);
+          return 1;
+        }
+        break;
+      case 'W': walk_report = true; break;
+      case 'A': tune_file = optarg; break;
+      case 'K': tuned_file = optarg; break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (verify)
+    return run_verify(max(1, trials), seed);
+
+  if (precision_report) {
+    int T = tsteps_set ? opts.tsteps[0] : 20 * DEFAULT_TSTEP;
+    const Algorithm *algo = opts.algos.empty() ? default_algorithm() : opts.algos[0];
+    if (X < 3 || Y < 3) {
+      fprintf(stderr, "invalid grid size\n");
+      return 1;
+    }
+    return run_precision_report(X, Y, T, algo);
+  }
+
+  if (!tsteps_set)
+    opts.tsteps = suite ? std::vector<int>{1, 5, 32, DEFAULT_TSTEP}
+                        : std::vector<int>{DEFAULT_TSTEP};
+
+  if (walk_report) {
+    if (X < 3 || Y < 3 || opts.tsteps.size() != 1 || opts.layouts.size() > 1 ||
+        opts.precisions.size() > 1) {
+      fprintf(stderr, "invalid grid size, timestep count, layout or precision\n");
+      return 1;
+    }
+    if (opts.algos.empty()) {
+      for (int i = 0; i < num_algorithms; ++i)
+        if ((algorithms[i].flags & ALG_RECURSIVE) && (algorithms[i].flags & ALG_PARALLEL))
+          opts.algos.push_back(&algorithms[i]);
+    }
+    return run_walk_profile(X, Y, opts.tsteps[0], opts.algos,
+                            opts.layouts.empty() ? LAYOUT_TIME_OUTER : opts.layouts[0],
+                            opts.precisions.empty() ? PREC_FLOAT : opts.precisions[0]);
+  }
+
+  if (tune_file) {
+    TuneOptions tune;
+    tune.X = X;
+    tune.Y = Y;
+    tune.T = opts.tsteps[0];
+    if (!opts.layouts.empty())
+      tune.layout = opts.layouts[0];
+    if (!opts.precisions.empty())
+      tune.precision = opts.precisions[0];
+    if (reps > 0)
+      tune.reps = reps;
+    tune.verbose = true;
+    if (X < 3 || Y < 3 || opts.tsteps.size() != 1 || opts.layouts.size() > 1 ||
+        opts.precisions.size() > 1) {
+      fprintf(stderr, "invalid grid size, timestep count, layout or precision\n");
+      return 1;
+    }
+    if (opts.algos.empty()) {
+      for (int i = 0; i < num_algorithms; ++i)
+        if ((algorithms[i].flags & (ALG_USES_STOPS | ALG_USES_COARSEN | ALG_USES_LT_THRESH)) &&
+            !(algorithms[i].flags & ALG_EXPERIMENTAL))
+          opts.algos.push_back(&algorithms[i]);
+    }
+    printf("device %s, grid %d x %d, %d timesteps, layout %s, precision %s, %u workers\n",
+           device_fingerprint().c_str(), X, Y, tune.T, layout_name(tune.layout),
+           precision_name(tune.precision), num_workers());
+    for (const Algorithm *algo : opts.algos) {
+      printf("%s:\n", algo->name);
+      WalkParams p;
+      if (!tuned_walk_params(tune_file, algo, tune, true, &p))
+        fprintf(stderr, "could not write %s\n", tune_file);
+      printf("%s: x_stop %d y_stop %d dt_stop %d lt_thresh %d coarsen %d\n", algo->name,
+             p.x_stop, p.y_stop, p.dt_stop, p.lt_thresh, p.coarsen);
+    }
+    return 0;
+  }
+
+  if (frames > 0) {
+    if (X < 3 || Y < 3 || opts.tsteps.size() != 1 || opts.algos.size() > 1 ||
+        opts.layouts.size() > 1 || opts.precisions.size() > 1) {
+      fprintf(stderr, "invalid grid size, timestep count, algorithm, layout or precision\n");
+      return 1;
+    }
+    // Defaults are the renderer's.
+    return run_frame_report(X, Y, opts.tsteps[0], frames,
+                            opts.algos.empty() ? default_algorithm() : opts.algos[0],
+                            opts.layouts.empty() ? LAYOUT_TIME_OUTER : opts.layouts[0],
+                            opts.precisions.empty() ? PREC_FLOAT : opts.precisions[0], fused,
+                            uint64_t(deadline_ms * 1e6));
+  }
+
+  if (suite) {
+    if (opts.sizes.empty())
+      opts.sizes = {32, 128, 512, 2048, 4096};
+    if (opts.workers.empty()) {
+      int nproc = int(sysconf(_SC_NPROCESSORS_ONLN));
+      for (int w = 1; w < nproc; w *= 2)
+        opts.workers.push_back(w);
+      opts.workers.push_back(max(1, nproc));
+    }
+    if (opts.algos.empty()) {
+      // Every parallel or trapezoidal decomposition of the stencil.
+      for (int i = 0; i < num_algorithms; ++i)
+        if ((algorithms[i].flags & ALG_STENCIL) &&
+            (algorithms[i].flags & (ALG_PARALLEL | ALG_RECURSIVE)))
+          opts.algos.push_back(&algorithms[i]);
+    }
+    if (opts.layouts.empty()) {
+      for (int i = 0; i < NUM_LAYOUTS; ++i)
+        opts.layouts.push_back(SimLayout(i));
+    }
+    if (opts.precisions.empty())
+      opts.precisions = {PREC_DOUBLE};
+    for (int size : opts.sizes) {
+      if (size < 3) {
+        fprintf(stderr, "invalid grid size %d\n", size);
+        return 1;
+      }
+    }
+    opts.reps = reps > 0 ? reps : 5;
+    return run_suite(argv[0], opts);
+  }
+
+  int T = opts.tsteps[0];
+  const Algorithm *algo = opts.algos.empty() ? default_algorithm() : opts.algos[0];
+  if (reps == 0)
+    reps = 3;
+  SimLayout layout = opts.layouts.empty() ? LAYOUT_TIME_INNER : opts.layouts[0];
+  SimPrecision precision = opts.precisions.empty() ? PREC_DOUBLE : opts.precisions[0];
+  if (X < 3 || Y < 3 || reps < 1 || opts.tsteps.size() != 1 || opts.algos.size() > 1 ||
+      opts.layouts.size() > 1 || opts.precisions.size() > 1) {
+    fprintf(stderr, "invalid grid size, timestep count, repetition count, algorithm, layout or "
+                    "precision\n");
+    return 1;
+  }
+
+  SimState *Q = new SimState(X, Y, true, layout, precision);
+  Q->set_sim_size(X, Y, T);
+  init_state(Q);
+  if (tuned_file) {
+    TuneOptions tune;
+    tune.X = X;
+    tune.Y = Y;
+    tune.layout = layout;
+    tune.precision = precision;
+    if (!load_walk_params(tuned_file, tune_key(algo, tune), &Q->walk)) {
+      fprintf(stderr, "no cutoffs for %s in %s; using the defaults\n", algo->name, tuned_file);
+    }
+  }
+  if (!strcmp(heat, "dense") || !strcmp(heat, "sparse")) {
+    Q->heat_sparse = !strcmp(heat, "sparse");
+  } else if (strcmp(heat, "auto")) {
+    fprintf(stderr, "invalid heat mode '%s'\n", heat);
+    return 1;
+  }
+
+  printf("algorithm %s, grid %d x %d, %d timesteps, layout %s, precision %s, heat %s, "
+         "%u workers\n", algo->name, X, Y, T, layout_name(layout), precision_name(precision),
+         Q->heat_sparse ? "sparse" : "dense", num_workers());
+  if (algo->flags & (ALG_USES_STOPS | ALG_USES_COARSEN | ALG_USES_LT_THRESH))
+    printf("x_stop %d y_stop %d dt_stop %d lt_thresh %d coarsen %d\n", Q->walk.x_stop,
+           Q->walk.y_stop, Q->walk.dt_stop, Q->walk.lt_thresh, Q->walk.coarsen);
+  double best = 0.0;
+  int t = 0;
+  for (int rep = 0; rep < reps; ++rep) {
+    uint64_t start = now_ns();
+    algo->fn(Q, t, t + T, 0, Q->X, 0, Q->Y);
+    uint64_t end = now_ns();
+    t += T;
+    double secs = double(end - start) * 1e-9;
+    double rate = double(X) * Y * T / secs;
+    best = max(best, rate);
+    printf("run %d: %.6f s, %.4g cells/s\n", rep, secs, rate);
+  }
+  printf("best: %.4g cells/s\n", best);
+
+  delete Q;
+  return 0;
+}
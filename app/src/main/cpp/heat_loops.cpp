@@ -28,7 +28,54 @@
 #include "common.h"
 #include "sim.h"
 
-void rect_loops_serial(const SimState *Q,
+// rect_loops_serial indexes through Q's macros and tests every cell for the
+// boundary when Q holds doubles, so that it stays an independent reference
+// for the SimView base cases, and goes through a SimView otherwise.
+template<class Grid>
+static void loops_serial(const Grid *Q,
+                         int t0, int t1,
+                         int x0, int x1,
+                         int my_y0, int my_y1) {
+  for (int t = t0; t < t1; t++) {
+    for (int x = x0; x < x1; x++) {
+      int y;
+      for (y = my_y0; y + 7 < my_y1; y += 8) {
+        Q->kernel_inline(t, x, y);
+        Q->kernel_inline(t, x, y + 1);
+        Q->kernel_inline(t, x, y + 2);
+        Q->kernel_inline(t, x, y + 3);
+        Q->kernel_inline(t, x, y + 4);
+        Q->kernel_inline(t, x, y + 5);
+        Q->kernel_inline(t, x, y + 6);
+        Q->kernel_inline(t, x, y + 7);
+      }
+      for (; y < my_y1; y++) {
+        Q->kernel_inline(t, x, y);
+      }
+    }
+  }
+}
+
+template<class Grid>
+static void loops_parallel(const Grid *Q,
+                           int t0, int t1,
+                           int x0, int x1,
+                           int my_y0, int my_y1) {
+
+  /* This is the first parallel version of heat equation,
+     which utilize the cilk_for.  Each row runs through the
+     boundary-peeled row kernel.
+   */
+  int t;
+  for (t = t0; t < t1; t++) {
+    cilk_for(int y = my_y0; y < my_y1; y++) {
+      Q->kernel_row(t, y, x0, x1);
+    }
+  }
+}
+
+template<class Grid>
+static void loops_null(const Grid *Q,
                        int t0, int t1,
                        int x0, int x1,
                        int my_y0, int my_y1) {
@@ -36,39 +83,47 @@ void rect_loops_serial(const SimState *Q,
     for (int x = x0; x < x1; x++) {
       int y;
       for (y = my_y0; y + 7 < my_y1; y += 8) {
-        Q->kernel(t, x, y);
-        Q->kernel(t, x, y + 1);
-        Q->kernel(t, x, y + 2);
-        Q->kernel(t, x, y + 3);
-        Q->kernel(t, x, y + 4);
-        Q->kernel(t, x, y + 5);
-        Q->kernel(t, x, y + 6);
-        Q->kernel(t, x, y + 7);
+        Q->null_kernel(t, x, y);
+        Q->null_kernel(t, x, y + 1);
+        Q->null_kernel(t, x, y + 2);
+        Q->null_kernel(t, x, y + 3);
+        Q->null_kernel(t, x, y + 4);
+        Q->null_kernel(t, x, y + 5);
+        Q->null_kernel(t, x, y + 6);
+        Q->null_kernel(t, x, y + 7);
       }
       for (; y < my_y1; y++) {
-        Q->kernel(t, x, y);
+        Q->null_kernel(t, x, y);
       }
     }
   }
 }
 
+void rect_loops_serial(const SimState *Q,
+                       int t0, int t1,
+                       int x0, int x1,
+                       int my_y0, int my_y1) {
+  if (Q->precision == PREC_DOUBLE)
+    loops_serial(Q, t0, t1, x0, x1, my_y0, my_y1);
+  else
+    with_sim_view(Q, [&](auto *V) { loops_serial(V, t0, t1, x0, x1, my_y0, my_y1); });
+}
+
 void rect_loops_parallel(const SimState *Q,
                          int t0, int t1,
                          int x0, int x1,
                          int my_y0, int my_y1) {
-
-  /* This is the first parallel version of heat equation,
-     which utilize the cilk_for
-   */
-  int t;
   assert(Q->Xsep > 0);
   assert(Q->Ysep > 0);
+  with_sim_view(Q, [&](auto *V) { loops_parallel(V, t0, t1, x0, x1, my_y0, my_y1); });
+}
 
-  for (t = t0; t < t1; t++) {
-    cilk_for (int x = x0; x < x1; x++) {
-      cilk_for(int y = my_y0; y < my_y1; y++) {
-        Q->kernel(t, x, y);
-      }
-    }
-  }
+void rect_null(const SimState *Q,
+               int t0, int t1,
+               int x0, int x1,
+               int my_y0, int my_y1) {
+  if (Q->precision == PREC_DOUBLE)
+    loops_null(Q, t0, t1, x0, x1, my_y0, my_y1);
+  else
+    with_sim_view(Q, [&](auto *V) { loops_null(V, t0, t1, x0, x1, my_y0, my_y1); });
 }
@@ -27,10 +27,10 @@
 #include "common.h"
 #include "sim.h"
 
-#define ltThresh 32
 // Serial recursive cache-oblivious code for stencil computation.
 static const int ds = 1;
-void walk2(const SimState* Q,
+template<class Grid>
+void walk2(const Grid *Q,
            int t0, int t1,
            int x0, int dx0, int x1, int dx1,
            int my_y0, int dmy_y0, int my_y1, int dmy_y1) {
@@ -102,7 +102,7 @@ void walk2(const SimState* Q,
       /*       ym + (-ds) * halft, -ds, my_y1 + dmy_y1 * halft, dmy_y1); */
 
     } else {
-      if (lt > ltThresh) {
+      if (lt > Q->walk.lt_thresh) {
         int halflt = lt / 2;
         walk2(Q, t0, t0 + halflt, x0, dx0, x1, dx1, my_y0, dmy_y0, my_y1, dmy_y1);
         walk2(Q, t0 + halflt, t1,
@@ -110,23 +110,7 @@ void walk2(const SimState* Q,
               my_y0 + dmy_y0 * halflt, dmy_y0, my_y1 + dmy_y1 * halflt, dmy_y1);
       } else {
         for (int t = 0; t < lt; ++t) {
-          // loop unrolled
-          for (int x = x0; x < x1; x++) {
-            int y;
-            for (y = my_y0; y + 7 < my_y1; y += 8) {
-              Q->kernel(t0 + t, x, y);
-              Q->kernel(t0 + t, x, y + 1);
-              Q->kernel(t0 + t, x, y + 2);
-              Q->kernel(t0 + t, x, y + 3);
-              Q->kernel(t0 + t, x, y + 4);
-              Q->kernel(t0 + t, x, y + 5);
-              Q->kernel(t0 + t, x, y + 6);
-              Q->kernel(t0 + t, x, y + 7);
-            }
-            for (; y < my_y1; y++) {
-              Q->kernel(t0 + t, x, y);
-            }
-          }
+          Q->kernel_single_timestep(t0 + t, x0, x1, my_y0, my_y1);
           x0 += dx0;
           my_y0 += dmy_y0;
           x1 += dx1;
@@ -141,10 +125,7 @@ void rect_recursive_serial(const SimState* Q,
                            int t0, int t1,
                            int x0, int x1,
                            int my_y0, int my_y1) {
-  walk2(Q,
-        t0, t1,
-        x0, 0,
-        x1, 0,
-        my_y0, 0,
-        my_y1, 0);
+  with_sim_view(Q, [&](auto *V) {
+    walk2(V, t0, t1, x0, 0, x1, 0, my_y0, 0, my_y1, 0);
+  });
 }
@@ -24,12 +24,12 @@
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <cilk/cilk.h>
 #include <cstdio>
 #include <cstdlib>
 #include <string>
 #include "common.h"
 #include "sim.h"
+#include "walk_profile.h"
 
 void debug(const char *name, int t0, int t1, int x0, int dx0, int x1, int dx1,
            int y0, int dy0, int y1, int dy1) {
@@ -42,16 +42,18 @@ void debug(const char *name, int t0, int t1, int x0, int dx0, int x1, int dx1,
 
 // Serial recursive cache-oblivious code for stencil computation.
 static const int ds = 1;
-static const int coarsen = 5;
 
-static inline void walk_dp_t(const SimState *Q,
+template<class Grid>
+static inline void walk_dp_t(const Grid *Q,
                              int t0, int t1,
                              int x0, int dx0, int x1, int dx1,
                              int y0, int dy0, int y1, int dy1) {
   /* This is steve's original dual-partition version
    */
   int lt = t1 - t0;
+  const int coarsen = Q->walk.coarsen;
   if (lt <= coarsen && lt > 0) {
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     for (int i = t0; i < t1; i++) {
       Q->kernel_single_timestep(i, x0, x1, y0, y1);
       x0 += dx0;
@@ -126,19 +128,18 @@ static inline void walk_dp_t(const SimState *Q,
   }
 }
 
-#define X_STOP 64 // 100
-#define Y_STOP 64 // 100
 #define SLOPE_X 1
 #define SLOPE_Y 1
-#define DT_STOP 5
 
-static inline void walk_dp_xyt(const SimState *Q,
+template<class Grid>
+static inline void walk_dp_xyt(const Grid *Q,
                                int t0, int t1,
                                int x0, int dx0, int x1, int dx1,
                                int y0, int dy0, int y1, int dy1) {
   /* This is steve's original dual-partition version
    */
   int lt = t1 - t0;
+  const int x_stop = Q->walk.x_stop, y_stop = Q->walk.y_stop, dt_stop = Q->walk.dt_stop;
   int cur_bl_x = x1 - x0;
   int cur_bl_y = y1 - y0;
   int cur_ul_x = x1 + dx1 - x0 - dx0;
@@ -149,16 +150,17 @@ static inline void walk_dp_xyt(const SimState *Q,
    */
   bool xwellShaped = dx0 >= 0 && dx1 <= 0;
   bool ywellShaped = dy0 >= 0 && dy1 <= 0;
-  if (((xwellShaped && cur_bl_x <= X_STOP) ||
-       (!xwellShaped && cur_ul_x <= X_STOP)) &&
-      ((ywellShaped && cur_bl_y <= Y_STOP) ||
-       (!ywellShaped && cur_ul_y <= X_STOP)) &&
-      lt <= DT_STOP) {
+  if (((xwellShaped && cur_bl_x <= x_stop) ||
+       (!xwellShaped && cur_ul_x <= x_stop)) &&
+      ((ywellShaped && cur_bl_y <= y_stop) ||
+       (!ywellShaped && cur_ul_y <= y_stop)) &&
+      lt <= dt_stop) {
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     return;
   } else {
     if (xwellShaped && cur_bl_x > x_cut_thres
-        && cur_bl_x > X_STOP) { // bottom >= top && bottom sufficiently large
+        && cur_bl_x > x_stop) { // bottom >= top && bottom sufficiently large
       int mid = (x0 + x1) / 2;
       cilk_scope{
           cilk_spawn walk_dp_xyt(Q, t0, t1, x0, dx0, mid, -SLOPE_X, y0, dy0, y1, dy1); // bottom left triangle
@@ -167,7 +169,7 @@ static inline void walk_dp_xyt(const SimState *Q,
       walk_dp_xyt(Q, t0, t1, mid, -SLOPE_X, mid, SLOPE_X, y0, dy0, y1, dy1); // top mid triangle
       return;
     } else if (!xwellShaped && cur_ul_x > x_cut_thres
-               && cur_ul_x > X_STOP) { // top > bottom && top sufficiently large
+               && cur_ul_x > x_stop) { // top > bottom && top sufficiently large
       int mid = (x0 + dx0 * lt + x1 + dx1 * lt) / 2;
 
       int bLeft = mid - SLOPE_X * lt;
@@ -182,7 +184,7 @@ static inline void walk_dp_xyt(const SimState *Q,
           dy1); // top right triangle
       }
       return;
-    } else if (ywellShaped && cur_bl_y > y_cut_thres && cur_bl_y > Y_STOP) {
+    } else if (ywellShaped && cur_bl_y > y_cut_thres && cur_bl_y > y_stop) {
       int mid = (y0 + y1) / 2;
       cilk_scope{
           cilk_spawn walk_dp_xyt(Q, t0, t1, x0, dx0, x1, dx1, y0, dy0, mid, -SLOPE_Y); // bottom left triangle
@@ -191,7 +193,7 @@ static inline void walk_dp_xyt(const SimState *Q,
       walk_dp_xyt(Q, t0, t1, x0, dx0, x1, dx1, mid, -SLOPE_Y, mid, SLOPE_Y); // top mid triangle
       return;
     } else if (!ywellShaped && cur_ul_y > y_cut_thres
-               && cur_ul_y > Y_STOP) { // top > bottom && top sufficiently large
+               && cur_ul_y > y_stop) { // top > bottom && top sufficiently large
       int mid = (y0 + dy0 * lt + y1 + dy1 * lt) / 2;
 
       int bLeft = mid - SLOPE_Y * lt;
@@ -205,7 +207,7 @@ static inline void walk_dp_xyt(const SimState *Q,
           dy1); // top right triangle
       }
       return;
-    } else if (lt > DT_STOP) {
+    } else if (lt > dt_stop) {
       int halflt = lt / 2;
       walk_dp_xyt(Q, t0, t0 + halflt, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
       walk_dp_xyt(Q, t0 + halflt, t1,
@@ -213,28 +215,35 @@ static inline void walk_dp_xyt(const SimState *Q,
                   y0 + dy0 * halflt, dy0, y1 + dy1 * halflt, dy1);
       return;
     }
-
+    // No cut applies, as when a region wider than x_stop is too narrow to
+    // cut at its height, which small cutoffs make possible; the base case
+    // computes any region correctly, if less cache-efficiently.
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
+    Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
   }
 }
 
-static inline void walk_dp_xy_ucut(const SimState *Q,
+template<class Grid>
+static inline void walk_dp_xy_ucut(const Grid *Q,
                                    int t0, int t1,
                                    int x0, int dx0, int x1, int dx1,
                                    int y0, int dy0, int y1, int dy1) {
   /* This is steve's original dual-partition version
    */
   int lt = t1 - t0;
+  const int x_stop = Q->walk.x_stop, y_stop = Q->walk.y_stop, dt_stop = Q->walk.dt_stop;
   int cur_bl_x = x1 - x0;
   int cur_bl_y = y1 - y0;
   int x_cut_thres = 4 * SLOPE_X * lt;
   int y_cut_thres = 4 * SLOPE_Y * lt;
   /* By well-shaped, we mean bottom >= top, otherwise, it's !wellShaped
    */
-  if (lt <= 1 || (cur_bl_x <= X_STOP && cur_bl_y <= Y_STOP && lt <= DT_STOP)) {
+  if (lt <= 1 || (cur_bl_x <= x_stop && cur_bl_y <= y_stop && lt <= dt_stop)) {
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     return;
   } else {
-    if (lt <= DT_STOP && cur_bl_x > x_cut_thres) {
+    if (lt <= dt_stop && cur_bl_x > x_cut_thres) {
       int mid = (x0 + x1) / 2;
       cilk_scope{
           cilk_spawn walk_dp_xy_ucut(Q, t0, t1, x0, SLOPE_X, mid, -SLOPE_X, y0, dy0, y1, dy1);
@@ -249,7 +258,7 @@ static inline void walk_dp_xy_ucut(const SimState *Q,
           }
       }
       return;
-    } else if (lt <= DT_STOP && cur_bl_y > y_cut_thres) {
+    } else if (lt <= dt_stop && cur_bl_y > y_cut_thres) {
       int mid = (y0 + y1) / 2;
       cilk_scope{
           cilk_spawn walk_dp_xy_ucut(Q, t0, t1, x0, dx0, x1, dx1, y0, SLOPE_Y, mid, -SLOPE_Y);
@@ -264,7 +273,7 @@ static inline void walk_dp_xy_ucut(const SimState *Q,
           }
       }
       return;
-    } else if (lt > DT_STOP) {
+    } else if (lt > dt_stop) {
       int halflt = lt / 2;
       walk_dp_xy_ucut(Q, t0, t0 + halflt, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
       walk_dp_xy_ucut(Q, t0 + halflt, t1,
@@ -272,28 +281,35 @@ static inline void walk_dp_xy_ucut(const SimState *Q,
                       y0 + dy0 * halflt, dy0, y1 + dy1 * halflt, dy1);
       return;
     }
-
+    // No cut applies; see walk_dp_xyt.
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
+    Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
   }
 }
 
-static inline void walk_dp_xyt_ucut2(const SimState *Q,
+template<class Grid>
+static inline void walk_dp_xyt_ucut2(const Grid *Q,
                                      int t0, int t1,
                                      int x0, int dx0, int x1, int dx1,
                                      int y0, int dy0, int y1, int dy1) {
   /* This is steve's original dual-partition version
    */
   int lt = t1 - t0;
+  const int x_stop = Q->walk.x_stop, y_stop = Q->walk.y_stop, dt_stop = Q->walk.dt_stop;
   int cur_bl_x = x1 - x0;
   int cur_bl_y = y1 - y0;
-  int x_cut_thres = 4 * SLOPE_X * lt;
-  int y_cut_thres = 4 * SLOPE_Y * lt;
+  // Each outer third must stay at least 2 * SLOPE * lt wide, or the
+  // upright trapezoids would invert and leave cells uncomputed.
+  int x_cut_thres = 6 * SLOPE_X * lt;
+  int y_cut_thres = 6 * SLOPE_Y * lt;
   /* By well-shaped, we mean bottom >= top, otherwise, it's !wellShaped
    */
-  if (cur_bl_x <= X_STOP && cur_bl_y <= Y_STOP && lt <= DT_STOP) {
+  if (cur_bl_x <= x_stop && cur_bl_y <= y_stop && lt <= dt_stop) {
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     return;
   } else {
-    if (cur_bl_x > x_cut_thres && cur_bl_x > X_STOP) {
+    if (cur_bl_x > x_cut_thres && cur_bl_x > x_stop) {
       //int mid = (x0 + x1) / 2;
       int third = (x1 - x0) / 3;
       cilk_scope{
@@ -311,7 +327,7 @@ static inline void walk_dp_xyt_ucut2(const SimState *Q,
           //std::cout << "something 1" << std::endl;
       }
       return;
-    } else if (cur_bl_y > y_cut_thres && cur_bl_y > Y_STOP) {
+    } else if (cur_bl_y > y_cut_thres && cur_bl_y > y_stop) {
       //int mid = (y0 + y1) / 2;
       int third = (y1 - y0) / 3;
       cilk_scope{
@@ -329,7 +345,7 @@ static inline void walk_dp_xyt_ucut2(const SimState *Q,
           //std::cout << "something 2" << std::endl;
       }
       return;
-    } else if (lt > DT_STOP) {
+    } else if (lt > dt_stop) {
       int halflt = lt / 2;
       walk_dp_xyt_ucut2(Q, t0, t0 + halflt, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
       walk_dp_xyt_ucut2(Q, t0 + halflt, t1,
@@ -337,28 +353,33 @@ static inline void walk_dp_xyt_ucut2(const SimState *Q,
                         y0 + dy0 * halflt, dy0, y1 + dy1 * halflt, dy1);
       return;
     }
-
+    // No cut applies; see walk_dp_xyt.
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
+    Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
   }
 }
 
-static inline void walk_dp_xyt_ucut(const SimState *Q,
+template<class Grid>
+static inline void walk_dp_xyt_ucut(const Grid *Q,
                                     int t0, int t1,
                                     int x0, int dx0, int x1, int dx1,
                                     int y0, int dy0, int y1, int dy1) {
   /* This is steve's original dual-partition version
    */
   int lt = t1 - t0;
+  const int x_stop = Q->walk.x_stop, y_stop = Q->walk.y_stop, dt_stop = Q->walk.dt_stop;
   int cur_bl_x = x1 - x0;
   int cur_bl_y = y1 - y0;
   int x_cut_thres = 4 * SLOPE_X * lt;
   int y_cut_thres = 4 * SLOPE_Y * lt;
   /* By well-shaped, we mean bottom >= top, otherwise, it's !wellShaped
    */
-  if (cur_bl_x <= X_STOP && cur_bl_y <= Y_STOP && lt <= DT_STOP) {
+  if (cur_bl_x <= x_stop && cur_bl_y <= y_stop && lt <= dt_stop) {
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     return;
   } else {
-    if (cur_bl_x > x_cut_thres && cur_bl_x > X_STOP) {
+    if (cur_bl_x > x_cut_thres && cur_bl_x > x_stop) {
       int mid = (x0 + x1) / 2;
       cilk_scope{
           cilk_spawn walk_dp_xyt_ucut(Q, t0, t1, x0, SLOPE_X, mid, -SLOPE_X, y0, dy0, y1, dy1);
@@ -373,7 +394,7 @@ static inline void walk_dp_xyt_ucut(const SimState *Q,
           }
       }
       return;
-    } else if (cur_bl_y > y_cut_thres && cur_bl_y > Y_STOP) {
+    } else if (cur_bl_y > y_cut_thres && cur_bl_y > y_stop) {
       int mid = (y0 + y1) / 2;
       cilk_scope{
           cilk_spawn walk_dp_xyt_ucut(Q, t0, t1, x0, dx0, x1, dx1, y0, SLOPE_Y, mid, -SLOPE_Y);
@@ -388,7 +409,7 @@ static inline void walk_dp_xyt_ucut(const SimState *Q,
           }
       }
       return;
-    } else if (lt > DT_STOP) {
+    } else if (lt > dt_stop) {
       int halflt = lt / 2;
       walk_dp_xyt_ucut(Q, t0, t0 + halflt, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
       walk_dp_xyt_ucut(Q, t0 + halflt, t1,
@@ -396,28 +417,33 @@ static inline void walk_dp_xyt_ucut(const SimState *Q,
                        y0 + dy0 * halflt, dy0, y1 + dy1 * halflt, dy1);
       return;
     }
-
+    // No cut applies; see walk_dp_xyt.
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
+    Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
   }
 }
 
 
-static inline void walk_dp_xyt_ucut_fixed(const SimState *Q,
+template<class Grid>
+static inline void walk_dp_xyt_ucut_fixed(const Grid *Q,
                                           int t0, int t1,
                                           int x0, int dx0, int x1, int dx1,
                                           int y0, int dy0, int y1, int dy1) {
   /* This is steve's original dual-partition version
    */
   int lt = t1 - t0;
+  const int x_stop = Q->walk.x_stop, y_stop = Q->walk.y_stop, dt_stop = Q->walk.dt_stop;
   int cur_bl_x = x1 - x0;
   int cur_bl_y = y1 - y0;
   int x_cut_thres = 4 * SLOPE_X * lt;
   int y_cut_thres = 4 * SLOPE_Y * lt;
 
-  if (cur_bl_x <= X_STOP && cur_bl_y <= Y_STOP && lt <= DT_STOP) {
+  if (cur_bl_x <= x_stop && cur_bl_y <= y_stop && lt <= dt_stop) {
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     return;
   } else {
-    if (cur_bl_x > x_cut_thres && cur_bl_x >= 2 * X_STOP) {
+    if (cur_bl_x > x_cut_thres && cur_bl_x >= 2 * x_stop) {
       int mid = (x0 + x1) / 2;
       debug("cut into mid-X\n", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
       cilk_scope{
@@ -433,20 +459,20 @@ static inline void walk_dp_xyt_ucut_fixed(const SimState *Q,
           }
       }
       return;
-    } else if (cur_bl_x > x_cut_thres && cur_bl_x > X_STOP && cur_bl_x < 2 * X_STOP) {
-      assert(cur_bl_x < 2 * X_STOP);
+    } else if (cur_bl_x > x_cut_thres && cur_bl_x > x_stop && cur_bl_x < 2 * x_stop) {
+      assert(cur_bl_x < 2 * x_stop);
       debug("cut into 100-block X\n", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
-      debug("ucut_fixed1", t0, t1, x0, SLOPE_X, x0 + X_STOP, -SLOPE_X, y0, dy0, y1, dy1);
+      debug("ucut_fixed1", t0, t1, x0, SLOPE_X, x0 + x_stop, -SLOPE_X, y0, dy0, y1, dy1);
       cilk_scope{
-          cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0, SLOPE_X, x0 + X_STOP, -SLOPE_X, y0, dy0, y1, dy1);
+          cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0, SLOPE_X, x0 + x_stop, -SLOPE_X, y0, dy0, y1, dy1);
           cilk_sync;
           debug("ucut_fixed2", t0, t1, x0, dx0, x0, SLOPE_X, y0, dy0, y1, dy1);
           cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0, dx0, x0, SLOPE_X, y0, dy0, y1, dy1);
-          debug("ucut_fixed3", t0, t1, x0 + X_STOP, -SLOPE_X, x1, dx1, y0, dy0, y1, dy1);
-          cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0 + X_STOP, -SLOPE_X, x1, dx1, y0, dy0, y1, dy1);
+          debug("ucut_fixed3", t0, t1, x0 + x_stop, -SLOPE_X, x1, dx1, y0, dy0, y1, dy1);
+          cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0 + x_stop, -SLOPE_X, x1, dx1, y0, dy0, y1, dy1);
       }
       return;
-    } else if (cur_bl_y > y_cut_thres && cur_bl_y >= 2 * Y_STOP) {
+    } else if (cur_bl_y > y_cut_thres && cur_bl_y >= 2 * y_stop) {
       int mid = (y0 + y1) / 2;
       debug("cut into mid-Y", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
       cilk_scope{
@@ -462,20 +488,20 @@ static inline void walk_dp_xyt_ucut_fixed(const SimState *Q,
           }
       }
       return;
-    } else if (cur_bl_y > y_cut_thres && cur_bl_y > Y_STOP && cur_bl_y < 2 * Y_STOP) {
-      assert(cur_bl_y < 2 * Y_STOP);
+    } else if (cur_bl_y > y_cut_thres && cur_bl_y > y_stop && cur_bl_y < 2 * y_stop) {
+      assert(cur_bl_y < 2 * y_stop);
       debug("cut into 100-block Y", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
-      debug("ucut_fixed4", t0, t1, x0, dx0, x1, dx1, y0, SLOPE_Y, y0 + Y_STOP, -SLOPE_Y);
+      debug("ucut_fixed4", t0, t1, x0, dx0, x1, dx1, y0, SLOPE_Y, y0 + y_stop, -SLOPE_Y);
       cilk_scope{
-          cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0, dx0, x1, dx1, y0, SLOPE_Y, y0 + Y_STOP, -SLOPE_Y);
+          cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0, dx0, x1, dx1, y0, SLOPE_Y, y0 + y_stop, -SLOPE_Y);
           cilk_sync;
           debug("ucut_fixed5", t0, t1, x0, dx0, x1, dx1, y0, dy0, y0, SLOPE_Y);
           cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0, dx0, x1, dx1, y0, dy0, y0, SLOPE_Y);
-          debug("ucut_fixed6", t0, t1, x0, dx0, x1, dx1, y0 + Y_STOP, -SLOPE_Y, y1, dy1);
-          cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0, dx0, x1, dx1, y0 + Y_STOP, -SLOPE_Y, y1, dy1);
+          debug("ucut_fixed6", t0, t1, x0, dx0, x1, dx1, y0 + y_stop, -SLOPE_Y, y1, dy1);
+          cilk_spawn walk_dp_xyt_ucut_fixed(Q, t0, t1, x0, dx0, x1, dx1, y0 + y_stop, -SLOPE_Y, y1, dy1);
       }
       return;
-    } else if (lt > DT_STOP) {
+    } else if (lt > dt_stop) {
       int halflt = lt / 2;
       walk_dp_xyt_ucut_fixed(Q, t0, t0 + halflt, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
       walk_dp_xyt_ucut_fixed(Q, t0 + halflt, t1,
@@ -483,25 +509,30 @@ static inline void walk_dp_xyt_ucut_fixed(const SimState *Q,
                              y0 + dy0 * halflt, dy0, y1 + dy1 * halflt, dy1);
       return;
     }
-
+    // No cut applies; see walk_dp_xyt.
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
+    Q->base_case_kernel(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
   }
 }
 
 
-void walk_dp_cq(const SimState *Q,
+template<class Grid>
+void walk_dp_cq(const Grid *Q,
                 int t0, int t1,
                 int x0, int dx0, int x1, int dx1,
                 int y0, int dy0, int y1, int dy1) {
   /* This is steve's original dual-partition version
    */
   int lt = t1 - t0;
+  const int x_stop = Q->walk.x_stop, y_stop = Q->walk.y_stop, dt_stop = Q->walk.dt_stop;
   int cur_bl_x = x1 - x0;
   int cur_bl_y = y1 - y0;
   int x_cut_thres = 4 * SLOPE_X * lt;
   int y_cut_thres = 4 * SLOPE_Y * lt;
-  if ((cur_bl_x <= X_STOP || cur_bl_x < x_cut_thres) && (cur_bl_y <= Y_STOP
+  if ((cur_bl_x <= x_stop || cur_bl_x < x_cut_thres) && (cur_bl_y <= y_stop
                                                          || cur_bl_y < y_cut_thres) &&
-      lt <= DT_STOP) {
+      lt <= dt_stop) {
+    WALK_LEAF(t0, t1, x0, dx0, x1, dx1, y0, dy0, y1, dy1);
     for (int i = t0; i < t1; i++) {
       Q->kernel_single_timestep(i, x0, x1, y0, y1);
       x0 += dx0;
@@ -542,12 +573,65 @@ void walk_dp_cq(const SimState *Q,
   }
 }
 
+void rect_recursive_dp_t(const SimState *Q,
+                         int t0, int t1,
+                         int x0, int x1,
+                         int my_y0, int my_y1) {
+  with_sim_view(Q, [&](auto *V) {
+    walk_dp_t(V, t0, t1, x0, 0, x1, 0, my_y0, 0, my_y1, 0);
+  });
+}
+
+void rect_recursive_dp_xyt(const SimState *Q,
+                           int t0, int t1,
+                           int x0, int x1,
+                           int my_y0, int my_y1) {
+  with_sim_view(Q, [&](auto *V) {
+    walk_dp_xyt(V, t0, t1, x0, 0, x1, 0, my_y0, 0, my_y1, 0);
+  });
+}
+
+void rect_recursive_dp_xy_ucut(const SimState *Q,
+                               int t0, int t1,
+                               int x0, int x1,
+                               int my_y0, int my_y1) {
+  with_sim_view(Q, [&](auto *V) {
+    walk_dp_xy_ucut(V, t0, t1, x0, 0, x1, 0, my_y0, 0, my_y1, 0);
+  });
+}
+
 void rect_recursive_dp_ucut(const SimState *Q,
                             int t0, int t1,
                             int x0, int x1,
                             int my_y0, int my_y1) {
-  walk_dp_xyt_ucut(Q,
-                   t0, t1,
-                   x0, 0, x1, 0,
-                   my_y0, 0, my_y1, 0);
+  with_sim_view(Q, [&](auto *V) {
+    walk_dp_xyt_ucut(V, t0, t1, x0, 0, x1, 0, my_y0, 0, my_y1, 0);
+  });
+}
+
+void rect_recursive_dp_ucut2(const SimState *Q,
+                             int t0, int t1,
+                             int x0, int x1,
+                             int my_y0, int my_y1) {
+  with_sim_view(Q, [&](auto *V) {
+    walk_dp_xyt_ucut2(V, t0, t1, x0, 0, x1, 0, my_y0, 0, my_y1, 0);
+  });
+}
+
+void rect_recursive_dp_ucut_fixed(const SimState *Q,
+                                  int t0, int t1,
+                                  int x0, int x1,
+                                  int my_y0, int my_y1) {
+  with_sim_view(Q, [&](auto *V) {
+    walk_dp_xyt_ucut_fixed(V, t0, t1, x0, 0, x1, 0, my_y0, 0, my_y1, 0);
+  });
+}
+
+void rect_recursive_dp_cq(const SimState *Q,
+                          int t0, int t1,
+                          int x0, int x1,
+                          int my_y0, int my_y1) {
+  with_sim_view(Q, [&](auto *V) {
+    walk_dp_cq(V, t0, t1, x0, 0, x1, 0, my_y0, 0, my_y1, 0);
+  });
 }
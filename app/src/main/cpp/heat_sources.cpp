@@ -0,0 +1,148 @@
+/* Persistent, named heat sources drawn into the raster every frame.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "heat_sources.h"
+
+int HeatSources::find(const char *name) const {
+  for (int i = 0; i < nsources; ++i)
+    if (strcmp(sources[i].name, name) == 0)
+      return i;
+  return -1;
+}
+
+void HeatSources::set(const char *name, float x, float y, float radius,
+                      float intensity, SourceShape shape) {
+  int i = find(name);
+  if (i < 0) {
+    if (nsources == cap) {
+      cap = 2 * cap + 8;
+      sources = (HeatSource *) realloc(sources, cap * sizeof(HeatSource));
+    }
+    i = nsources++;
+    snprintf(sources[i].name, sizeof(sources[i].name), "%s", name);
+  }
+  HeatSource &s = sources[i];
+  s.x = x;
+  s.y = y;
+  s.radius = radius;
+  s.intensity = intensity;
+  s.shape = shape;
+}
+
+bool HeatSources::remove(const char *name) {
+  int i = find(name);
+  if (i < 0)
+    return false;
+  sources[i] = sources[--nsources];
+  return true;
+}
+
+float HeatSources::peak_heat(float unit) const {
+  float peak = 0;
+  for (int i = 0; i < nsources; ++i)
+    peak = max(peak, sources[i].intensity * unit);
+  return peak;
+}
+
+// Fills the levels of the cells in box, row by row, for a source centered
+// at (cx, cy) with radius r in cells.
+static void stamp_source(const HeatSource &s, float cx, float cy, float r,
+                         int x0, int x1, int y0, int y1,
+                         float heat_inc, float unit, char *levels) {
+  float peak = s.intensity * unit;
+  char disc_level = heat_level(peak, heat_inc);
+  float inv_2sigma2 = 2.0f / (r * r);  // sigma = r / 2
+  for (int y = y0; y < y1; ++y) {
+    float dy = y - cy;
+    for (int x = x0; x < x1; ++x) {
+      float dx = x - cx;
+      float d2 = dx * dx + dy * dy;
+      char level = 0;
+      if (s.shape == SHAPE_DISC)
+        level = d2 <= r * r ? disc_level : 0;
+      else if (d2 <= 2.25f * r * r)
+        level = heat_level(peak * expf(-d2 * inv_2sigma2), heat_inc);
+      *levels++ = level;
+    }
+  }
+}
+
+void HeatSources::rasterize(SimState *Q, float heat_inc, float unit, bool parallel) {
+  if (nsources == 0 || heat_inc <= 0)
+    return;
+  if (boxes_cap < nsources) {
+    boxes_cap = cap;
+    boxes = (Box *) realloc(boxes, boxes_cap * sizeof(Box));
+  }
+  // Clip each source to the grid and lay out its levels.
+  size_t total = 0;
+  for (int i = 0; i < nsources; ++i) {
+    const HeatSource &s = sources[i];
+    float cx = s.x * Q->X, cy = s.y * Q->Y, r = max(s.radius * Q->X, 0.5f);
+    float extent = s.shape == SHAPE_GAUSSIAN ? 1.5f * r : r;
+    Box &b = boxes[i];
+    b.x0 = max(int(floorf(cx - extent)), 0);
+    b.x1 = min(int(ceilf(cx + extent)) + 1, Q->X);
+    b.y0 = max(int(floorf(cy - extent)), 0);
+    b.y1 = min(int(ceilf(cy + extent)) + 1, Q->Y);
+    if (b.x1 < b.x0)
+      b.x1 = b.x0;
+    if (b.y1 < b.y0)
+      b.y1 = b.y0;
+    b.offset = total;
+    total += size_t(b.x1 - b.x0) * (b.y1 - b.y0);
+  }
+  if (stamps_cap < total) {
+    stamps_cap = max(total, 2 * stamps_cap);
+    stamps = (char *) realloc(stamps, stamps_cap);
+  }
+
+  // The levels of different sources are independent, and a Gaussian costs
+  // an exp per cell, so they are computed in parallel...
+  auto stamp = [&](int i) {
+    const HeatSource &s = sources[i];
+    const Box &b = boxes[i];
+    stamp_source(s, s.x * Q->X, s.y * Q->Y, max(s.radius * Q->X, 0.5f),
+                 b.x0, b.x1, b.y0, b.y1, heat_inc, unit, stamps + b.offset);
+  };
+  if (parallel) {
+    cilk_for (int i = 0; i < nsources; ++i)
+      stamp(i);
+  } else {
+    for (int i = 0; i < nsources; ++i)
+      stamp(i);
+  }
+
+  // ...and merged serially, since sources may overlap and set_raster
+  // records the cells it writes.
+  for (int i = 0; i < nsources; ++i) {
+    const Box &b = boxes[i];
+    const char *levels = stamps + b.offset;
+    for (int y = b.y0; y < b.y1; ++y) {
+      for (int x = b.x0; x < b.x1; ++x) {
+        char level = *levels++;
+        if (level > Raster(Q, y, x))
+          Q->set_raster(x, y, level);
+      }
+    }
+  }
+}
@@ -0,0 +1,131 @@
+/* Persistent, named heat sources drawn into the raster every frame.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_HEAT_SOURCES_H
+#define CILKHEATDEMO2_HEAT_SOURCES_H
+
+#include "common.h"
+#include "sim.h"
+
+// Heat is added to a cell as Q->heat_inc times its raster value, so a frame
+// with several sources quantizes each cell's heat to MAX_HEAT_LEVEL levels
+// of the hottest cell: heat_inc is set to that cell's heat divided by
+// MAX_HEAT_LEVEL.
+#define MAX_HEAT_LEVEL 127
+
+// Raster level of a cell receiving heat h per timestep, or 0 if h rounds to
+// nothing.
+static inline char heat_level(float h, float heat_inc) {
+  float level = h / heat_inc + 0.5f;
+  return char(level >= MAX_HEAT_LEVEL ? MAX_HEAT_LEVEL : int(level));
+}
+
+enum SourceShape {
+  SHAPE_DISC,      // Constant heat out to the radius.
+  SHAPE_GAUSSIAN,  // Gaussian with sigma = radius / 2, cut off at 3 sigma.
+};
+
+static inline const char *source_shape_name(SourceShape shape) {
+  switch (shape) {
+    case SHAPE_DISC: return "disc";
+    case SHAPE_GAUSSIAN: return "gaussian";
+    default: return "unknown";
+  }
+}
+
+// Sets *shape to the shape called name; returns false if there is none.
+static inline bool find_source_shape(const char *name, SourceShape *shape) {
+  for (SourceShape s : {SHAPE_DISC, SHAPE_GAUSSIAN}) {
+    if (strcmp(name, source_shape_name(s)) == 0) {
+      *shape = s;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Position and radius are fractions of the grid's width and height (the
+// radius of its width), so that sources keep their place when the grid is
+// resized.  intensity is the heat per timestep of the hottest cell, in
+// units chosen by the caller.
+struct HeatSource {
+  char name[32];
+  float x, y, radius;
+  float intensity;
+  SourceShape shape;
+};
+
+class HeatSources {
+public:
+  ~HeatSources() {
+    free(sources);
+    free(boxes);
+    free(stamps);
+  }
+
+  // Adds the source called name, or replaces the one already there.
+  void set(const char *name, float x, float y, float radius, float intensity,
+           SourceShape shape);
+
+  // Removes the source called name; returns false if there is none.
+  bool remove(const char *name);
+
+  void clear() {
+    nsources = 0;
+  }
+
+  int count() const {
+    return nsources;
+  }
+
+  const HeatSource &operator[](int i) const {
+    return sources[i];
+  }
+
+  // Heat of the hottest cell, with intensity measured in units of unit.
+  float peak_heat(float unit) const;
+
+  // Draws every source into Q's raster through set_raster, keeping the
+  // larger level where a cell is already hot.  Each source's levels are
+  // computed into a buffer that is kept between frames, in parallel unless
+  // parallel is false; only the cells under the sources are touched.
+  void rasterize(SimState *Q, float heat_inc, float unit, bool parallel = true);
+
+private:
+  // Cells [x0, x1) x [y0, y1) that a source covers, and the offset of its
+  // levels in stamps.
+  struct Box {
+    int x0, x1, y0, y1;
+    size_t offset;
+  };
+
+  int find(const char *name) const;
+
+  HeatSource *sources = nullptr;
+  int nsources = 0, cap = 0;
+  Box *boxes = nullptr;
+  int boxes_cap = 0;
+  char *stamps = nullptr;
+  size_t stamps_cap = 0;
+};
+
+#endif  // CILKHEATDEMO2_HEAT_SOURCES_H
@@ -28,32 +28,27 @@
 #define CILKHEATDEMO2_SIM_H
 
 #include "common.h"
+#include "simd.h"
 
 /**************************************************/
-// Block size parameter.
+// Block size parameter: the blocked layouts store the grid as
+// BLOCK_DIM x BLOCK_DIM tiles.
 #ifdef BLOCK_VALUE
 #define LG_B BLOCK_VALUE
 #else
-#define LG_B 1
+#define LG_B 3
 #endif
 
 const int BLOCK_DIM = (1 << LG_B);
-const int LOW_MASK = (BLOCK_DIM - 1);
-const int HIGH_MASK = (~LOW_MASK);
-
-#define S_BLOCK_IDX(x) ((x) & HIGH_MASK)
-#define S_IDX(x) ((x) & LOW_MASK)
-#define ColMajorBOffset(Q, x, y) (((Q)->Ysep)*S_BLOCK_IDX(x) + BLOCK_DIM*(S_BLOCK_IDX(y) + S_IDX(x)) + S_IDX(y))
-#define RowMajorBOffset(Q, x, y) (((Q)->Xsep)*S_BLOCK_IDX(y) + BLOCK_DIM*(S_BLOCK_IDX(x) + S_IDX(y)) + S_IDX(x))
-
-// For an X by Y grid, the number of elements to allocate space
-#define BlockRound(X) (S_BLOCK_IDX(X) + BLOCK_DIM*(S_IDX(X)>0))
-#define GridSize(X, Y) (BlockRound(X) * BlockRound(Y))
 
 // variables for actual computation
 #define DEFAULT_TSTEP 175
 #define REAL_TIME_PER_TSTEP 0.00000175f
 
+// Room that SimState::reshape adds when it has to grow the buffers, as a
+// share of what the new grid needs.
+#define RESHAPE_SLACK 0.25
+
 #define Xmul 0.03            //X0,Y0,X1,Y1,T0,T1 tells the actual physical size of the grid,  X1 = X * Xmul
 #define Ymul 0.03
 
@@ -71,24 +66,126 @@ const double alpha = alpha_val;
 // Otherwise, if you pass in something like "t" is "q+1",
 // t&1  will get translated into q+1&1, which
 // will give the wrong answer.
-//
-// Various ways of indexing the array.
-#define RowMajorIdxTInner(Q, t, x, y) (2*((Q)->Xsep*(y) + x) + ((t)&1))
-#define ColMajorIdxTInner(Q, t, x, y) (2*((Q)->Ysep*(x) + y) + ((t)&1))
-#define RowMajorIdxTOuter(Q, t, x, y) ((Q)->Xsep*((Q)->Ysep)*((t)&1) + ((Q)->Xsep*(y) + x))
-#define ColMajorIdxTOuter(Q, t, x, y) ((Q)->Xsep*((Q)->Ysep)*((t)&1) + ((Q)->Ysep*(x) + y))
-#define RowMajorIdxTBlockInner(Q, t, x, y) (2*(RowMajorBOffset(Q, x, y)) + ((t)&1))
-#define ColMajorIdxTBlockInner(Q, t, x, y) (2*(ColMajorBOffset(Q, x, y)) + ((t)&1))
-
-#if (LG_B == 1)
-#define Idx(Q, t, x, y) RowMajorIdxTInner(Q, t, x, y)
-#else
-#define Idx(Q, t, x, y) RowMajorIdxTBlockInner(Q, t, x, y)
-#endif
 
+// Layouts selected at runtime through the fields of SimState (see
+// SimLayout).  CellOffset is the position of cell (x, y) in cells: tiles of
+// BlockDim x BlockDim cells in row-major order, row-major within a tile.
+// With BlockDim == 1 (BlockLow == 0) it reduces to Xsep*y + x.
+#define CellOffset(Q, x, y) \
+  ((Q)->Xsep*((y) & ~(Q)->BlockLow) + (((x) & ~(Q)->BlockLow) << (Q)->LgBlock) \
+   + (((y) & (Q)->BlockLow) << (Q)->LgBlock) + ((x) & (Q)->BlockLow))
+#define RowMajorIdxStrided(Q, t, x, y) \
+  ((Q)->TStride*((t)&1) + (Q)->XStride*CellOffset(Q, x, y))
+
+#define Idx(Q, t, x, y) RowMajorIdxStrided(Q, t, x, y)
+
+// Element of u, for PREC_DOUBLE states; SimState::value reads any precision.
 #define U(Q, t, x, y) (Q)->u[Idx(Q, t, x, y)]
 #define Uaddr(Q, t, x, y) ((Q)->u +  Idx(Q, t, x, y))
-#define Raster(Q, y, x) ((Q)->raster[(Q)->Ysep * (x) + (y)])
+// The heat source pattern is stored cell for cell like u, so that a run of
+// cells contiguous in u is contiguous in the raster as well.
+#define Raster(Q, y, x) ((Q)->raster[CellOffset(Q, x, y)])
+
+// Storage layouts of the two time planes of u.
+enum SimLayout {
+  // Values of a cell for even and odd t are adjacent (TStride 1).
+  LAYOUT_TIME_INNER,
+  // Separate row-major planes for even and odd t (XStride 1), so
+  // a cache line carries only values of the plane being read or written.
+  LAYOUT_TIME_OUTER,
+  // BLOCK_DIM x BLOCK_DIM tiles with adjacent time values.
+  LAYOUT_BLOCKED,
+  // BLOCK_DIM x BLOCK_DIM tiles in separate planes for even and odd t.
+  LAYOUT_BLOCKED_OUTER,
+  NUM_LAYOUTS
+};
+
+static inline const char *layout_name(SimLayout layout) {
+  switch (layout) {
+    case LAYOUT_TIME_INNER: return "inner";
+    case LAYOUT_TIME_OUTER: return "outer";
+    case LAYOUT_BLOCKED: return "blocked";
+    case LAYOUT_BLOCKED_OUTER: return "blocked_outer";
+    default: return "unknown";
+  }
+}
+
+static constexpr bool layout_is_blocked(SimLayout layout) {
+  return layout == LAYOUT_BLOCKED || layout == LAYOUT_BLOCKED_OUTER;
+}
+
+static constexpr bool layout_is_outer(SimLayout layout) {
+  return layout == LAYOUT_TIME_OUTER || layout == LAYOUT_BLOCKED_OUTER;
+}
+
+// Precision of the grid values and of the arithmetic on them.  The grid is
+// only ever shown as 8-bit color, so float storage loses nothing visible
+// while halving memory traffic and doubling the SIMD width.
+enum SimPrecision {
+  PREC_DOUBLE,  // double storage and arithmetic
+  PREC_FLOAT,   // float storage and arithmetic
+  PREC_MIXED,   // float storage, double arithmetic
+  NUM_PRECISIONS
+};
+
+static inline const char *precision_name(SimPrecision precision) {
+  switch (precision) {
+    case PREC_DOUBLE: return "double";
+    case PREC_FLOAT: return "float";
+    case PREC_MIXED: return "mixed";
+    default: return "unknown";
+  }
+}
+
+// A run of heat-source cells [x0, x1) of one row with the same raster value.
+struct HeatRun {
+  int x0, x1;
+  char value;
+};
+
+// Formats that the base cases can convert the last timestep to (see
+// OutputSink), as the renderer's texture formats hold it.
+enum OutputFormat {
+  OUT_RGBA,       // to_rgba
+  OUT_HALF,       // to_half
+  OUT_FLOAT,      // to_float
+  OUT_LUMINANCE,  // to_luminance
+};
+
+// Destination for the values of timestep t, converted to format, as the
+// base cases compute them: row y goes to dst + y * pitch, one texel per
+// cell.
+struct OutputSink {
+  long t;
+  OutputFormat format;
+  unsigned char *dst;
+  size_t pitch;
+};
+
+// Record of the cells whose color_code changes in timestep t, which the
+// base cases keep as they compute it: codes holds the code of cell (x, y)
+// at codes[y * pitch + x], which they compare and overwrite, and a tile
+// of tile by tile cells with a changed code has its flag in changed, at
+// tile row * tiles_x + tile column, set to 1.  Flags are never cleared.
+struct ChangeSink {
+  long t;
+  uint16_t *codes;
+  int pitch;
+  uint8_t *changed;
+  int tiles_x;
+  int tile;
+};
+
+// Cutoffs of the trapezoid walkers, which SimState carries so that they can
+// be tuned per device at runtime (see autotune.h).  The defaults are the
+// values they were compiled with before.
+struct WalkParams {
+  int x_stop = 64;     // Base-case width (heat_recursive_dp.cpp).
+  int y_stop = 64;     // Base-case height.
+  int dt_stop = 5;     // Base-case timesteps.
+  int lt_thresh = 32;  // Timesteps that walk2 runs as a loop.
+  int coarsen = 5;     // Timesteps of walk_dp_t's base case.
+};
 
 // Data structure which holds the simulation state.
 // To compare with the Lab 3 handout,
@@ -112,36 +209,353 @@ public:
   int Xsep = 0;    // Dimensions of the array to allocate.
   int Ysep = 0;    // This may be rounded up to nearst block size multiple.
 
+  // Layout of u, and the strides of t, x and y it implies.  XStride is the
+  // distance between x-neighbors within a row of a tile and YStride the
+  // distance between rows within a tile; cells in different tiles are
+  // located through CellOffset.
+  SimLayout layout = LAYOUT_TIME_INNER;
+  int TStride = 1;
+  int XStride = 2;
+  int YStride = 0;
+  int LgBlock = 0;  // Tiles are (1 << LgBlock) cells square.
+  int BlockLow = 0;  // (1 << LgBlock) - 1
+
+  SimPrecision precision = PREC_DOUBLE;
   double *u = nullptr; // the 2*Xsep*Ysep array to store the values.
+  float *uf = nullptr;  // the same in single precision, if PREC_FLOAT or PREC_MIXED
   char *raster = nullptr;  //here is the heat source pattern
 
   float heat_inc = 0.0;  //heat increased at each positive point in the pattern
 
-  SimState(int x_sep, int y_sep, bool zero_init)
-      : Xsep(BlockRound(x_sep)), Ysep(BlockRound(y_sep)) {
-    if (zero_init) {
-      u = (double *) calloc(GridSize(x_sep, y_sep) * 2, sizeof(double));
-      raster = (char *) calloc(GridSize(x_sep, y_sep), sizeof(char));
-    } else {
-      u = (double *) malloc(GridSize(x_sep, y_sep) * 2 * sizeof(double));
-      raster = (char *) malloc(GridSize(x_sep, y_sep) * sizeof(char));
-    }
+  // Sparse form of the raster, built by update_heat.  If heat_sparse, the
+  // base cases add the heat from these runs rather than reading the raster
+  // on every cell: the runs of row y are heat_runs[heat_row[y]] up to
+  // heat_runs[heat_row[y + 1]], sorted by x.
+  bool heat_sparse = false;
+  int *heat_row = nullptr;  // Ysep + 1 entries
+  HeatRun *heat_runs = nullptr;
+  int heat_nruns = 0;
+  int heat_cap = 0;
+
+  // If set, the row kernels also write each row they compute at time
+  // output->t to output, while it is still in cache, which saves the
+  // renderer a pass over the grid.  Only algorithms flagged
+  // ALG_FUSED_OUTPUT compute through the row kernels.
+  const OutputSink *output = nullptr;
+
+  // If set, the row kernels also compare each row they compute at time
+  // changes->t with its codes and flag the tiles that changed, so that the
+  // renderer reads only those.  Only algorithms flagged ALG_FUSED_OUTPUT
+  // honor it.
+  const ChangeSink *changes = nullptr;
+
+  WalkParams walk;
+
+  // Cells written by set_raster since the last clear, as y * Xsep + x, so
+  // that clear_raster and update_heat_dirty touch only those.  raster_mark
+  // holds the generation in which each cell was last listed, which keeps
+  // the list free of duplicates without clearing the marks every frame.
+  // Past raster_dirty_cap cells, the list gives up and the whole raster is
+  // treated as dirty.
+  int *raster_dirty = nullptr;
+  int raster_ndirty = 0;
+  int raster_dirty_cap = 0;
+  bool raster_overflow = false;
+  uint16_t *raster_mark = nullptr;
+  uint16_t raster_gen = 1;
+  int *raster_span = nullptr;  // Scratch for update_heat_dirty; 2 * Ysep.
+
+  // Cells per time plane and rows that the buffers have room for: cells()
+  // and Ysep, or more once reshape has shrunk the grid.
+  size_t capacity = 0;
+  int row_capacity = 0;
+
+  SimState(int x_sep, int y_sep, bool zero_init, SimLayout layout = LAYOUT_TIME_INNER,
+           SimPrecision precision = PREC_DOUBLE)
+      : layout(layout), precision(precision) {
+    set_dims(x_sep, y_sep);
+    allocate(cells(), Ysep, zero_init);
+  }
+
+  // Number of cells used per time plane.
+  size_t cells() const {
+    return size_t(Xsep) * Ysep;
   }
 
   ~SimState() {
-    free(u);
-    free(raster);
+    release();
+  }
+
+  // Makes this an x_sep by y_sep array with the same layout and precision,
+  // as the constructor would, but keeps the buffers if they have room and
+  // otherwise grows them by RESHAPE_SLACK, so that a series of resizes
+  // rarely allocates.  Leaves the grid values undefined and the raster and
+  // heat sources empty; call set_sim_size after.
+  void reshape(int x_sep, int y_sep) {
+    set_dims(x_sep, y_sep);
+    if (cells() > capacity) {
+      release();
+      allocate(cells() + size_t(cells() * RESHAPE_SLACK),
+               max(Ysep + int(Ysep * RESHAPE_SLACK), row_capacity), false);
+    } else if (Ysep > row_capacity) {
+      // Only the per-row arrays, as when the grid turns on its side.
+      row_capacity = Ysep + int(Ysep * RESHAPE_SLACK);
+      heat_row = (int *) realloc(heat_row, (row_capacity + 1) * sizeof(int));
+      raster_span = (int *) realloc(raster_span, 2 * row_capacity * sizeof(int));
+    }
+    memset(raster, 0, cells() * sizeof(char));
+    memset(raster_mark, 0, cells() * sizeof(uint16_t));
+    raster_gen = 1;
+    raster_ndirty = 0;
+    raster_overflow = false;
+    memset(heat_row, 0, (Ysep + 1) * sizeof(int));
+    heat_nruns = 0;
+    heat_sparse = false;
+  }
+
+  void clear_raster_array() {
+    memset(raster, 0, cells() * sizeof(char));
+    reset_raster_dirty();
   }
 
-  void clear_raster_array() const {
-    memset(raster, 0, GridSize(Xsep, Ysep) * sizeof(char));
+  // Sets a raster cell and records it for clear_raster and
+  // update_heat_dirty.  Cells written directly through Raster need
+  // clear_raster_array and update_heat instead.
+  void set_raster(int x, int y, char v) {
+    Raster(this, y, x) = v;
+    uint16_t &mark = raster_mark[CellOffset(this, x, y)];
+    if (mark == raster_gen)
+      return;
+    mark = raster_gen;
+    if (raster_ndirty == raster_dirty_cap)
+      raster_overflow = true;
+    else
+      raster_dirty[raster_ndirty++] = y * Xsep + x;
   }
 
-  void clear() const {
+  // Zeroes the cells written by set_raster since the last clear.
+  void clear_raster() {
+    if (raster_overflow) {
+      clear_raster_array();
+      return;
+    }
+    for (int i = 0; i < raster_ndirty; ++i)
+      Raster(this, raster_dirty[i] / Xsep, raster_dirty[i] % Xsep) = 0;
+    reset_raster_dirty();
+  }
+
+  void reset_raster_dirty() {
+    raster_ndirty = 0;
+    raster_overflow = false;
+    if (++raster_gen == 0) {
+      memset(raster_mark, 0, cells() * sizeof(uint16_t));
+      raster_gen = 1;
+    }
+  }
+
+  void clear() {
     clear_raster_array();
-    memset(u, 0, GridSize(Xsep, Ysep) * sizeof(double));
+    if (u)
+      memset(u, 0, cells() * 2 * sizeof(double));
+    if (uf)
+      memset(uf, 0, cells() * 2 * sizeof(float));
+  }
+
+  // Copies the grid values and heat source of src, which must have been
+  // allocated with the same dimensions.
+  void copy_from(const SimState *src) {
+    assert(Xsep == src->Xsep && Ysep == src->Ysep && layout == src->layout &&
+           precision == src->precision);
+    if (u)
+      memcpy(u, src->u, cells() * 2 * sizeof(double));
+    if (uf)
+      memcpy(uf, src->uf, cells() * 2 * sizeof(float));
+    memcpy(raster, src->raster, cells() * sizeof(char));
+    reset_raster_dirty();
+    raster_overflow = true;
+    heat_inc = src->heat_inc;
+    reserve_heat_runs(src->heat_nruns);
+    memcpy(heat_row, src->heat_row, (Ysep + 1) * sizeof(int));
+    memcpy(heat_runs, src->heat_runs, src->heat_nruns * sizeof(HeatRun));
+    heat_nruns = src->heat_nruns;
+    heat_sparse = src->heat_sparse;
   }
 
+  // Copies only the grid values at time t of src, which must have been
+  // allocated like this state; the heat source is left alone.
+  void copy_plane_from(const SimState *src, long t) {
+    assert(Xsep == src->Xsep && Ysep == src->Ysep && layout == src->layout &&
+           precision == src->precision);
+    size_t n = cells(), first = TStride * (t & 1);
+    if (layout_is_outer(layout)) {
+      if (u)
+        memcpy(u + first, src->u + first, n * sizeof(double));
+      if (uf)
+        memcpy(uf + first, src->uf + first, n * sizeof(float));
+      return;
+    }
+    for (size_t i = first; i < 2 * n; i += 2) {
+      if (u)
+        u[i] = src->u[i];
+      if (uf)
+        uf[i] = src->uf[i];
+    }
+  }
+
+  // Rebuilds the heat runs from rows [y0, y1) of the raster, which must
+  // hold the only heat sources, and switches the base cases to them unless
+  // the sources are dense enough that reading the raster is cheaper (or
+  // allow_sparse is false).  Call after changing the raster.
+  void update_heat(int y0, int y1, bool allow_sparse = true) {
+    y0 = max(y0, 0);
+    y1 = min(y1, Y);
+    heat_nruns = 0;
+    int y = 0;
+    for (; y < y0; ++y)
+      heat_row[y] = 0;
+    for (; y < y1; ++y) {
+      heat_row[y] = heat_nruns;
+      scan_heat_runs(y, 0, X);
+    }
+    for (; y <= Y; ++y)
+      heat_row[y] = heat_nruns;
+    // A run costs about as much as a few cells of the dense pass.
+    heat_sparse = allow_sparse && size_t(heat_nruns) * 16 < size_t(X) * Y;
+  }
+
+  // Appends the runs of row y that lie in [x0, x1).
+  void scan_heat_runs(int y, int x0, int x1) {
+    int x = x0;
+    while (x < x1) {
+      char v = Raster(this, y, x);
+      if (!v) {
+        ++x;
+        continue;
+      }
+      int start = x;
+      while (x < x1 && Raster(this, y, x) == v)
+        ++x;
+      reserve_heat_runs(heat_nruns + 1);
+      heat_runs[heat_nruns++] = {start, x, v};
+    }
+  }
+
+  void update_heat(bool allow_sparse = true) {
+    update_heat(0, Y, allow_sparse);
+  }
+
+  // Same as update_heat, for a raster whose only nonzero cells are those
+  // written by set_raster since the last clear.  Scans only the span of
+  // each row between its first and last such cell, so it costs time in the
+  // number of rows and the width of those spans rather than the size of
+  // the grid.
+  void update_heat_dirty(bool allow_sparse = true) {
+    if (raster_overflow) {
+      update_heat(allow_sparse);
+      return;
+    }
+    int *lo = raster_span, *hi = raster_span + Ysep;
+    for (int y = 0; y < Y; ++y) {
+      lo[y] = X;
+      hi[y] = 0;
+    }
+    for (int i = 0; i < raster_ndirty; ++i) {
+      int y = raster_dirty[i] / Xsep, x = raster_dirty[i] % Xsep;
+      if (x >= X || y >= Y)
+        continue;
+      lo[y] = min(lo[y], x);
+      hi[y] = max(hi[y], x + 1);
+    }
+    heat_nruns = 0;
+    int y = 0;
+    for (; y < Y; ++y) {
+      heat_row[y] = heat_nruns;
+      scan_heat_runs(y, lo[y], hi[y]);
+    }
+    for (; y <= Y; ++y)
+      heat_row[y] = heat_nruns;
+    heat_sparse = allow_sparse && size_t(heat_nruns) * 16 < size_t(X) * Y;
+  }
+
+  void reserve_heat_runs(int n) {
+    if (n <= heat_cap)
+      return;
+    heat_cap = max(n, 2 * heat_cap + 64);
+    heat_runs = (HeatRun *) realloc(heat_runs, heat_cap * sizeof(HeatRun));
+  }
+
+  // Grid value at (t, x, y) in any precision.
+  double value(int t, int x, int y) const {
+    return u ? u[Idx(this, t, x, y)] : uf[Idx(this, t, x, y)];
+  }
+
+  void set_value(int t, int x, int y, double v) const {
+    if (u)
+      u[Idx(this, t, x, y)] = v;
+    else
+      uf[Idx(this, t, x, y)] = float(v);
+  }
+
+  // Storage of u as Real, which must match precision.
+  template<typename Real>
+  Real *data() const;
+
+private:
+  // Sets Xsep, Ysep and the strides for an x_sep by y_sep grid.
+  void set_dims(int x_sep, int y_sep) {
+    // Untiled layouts keep rows of even length; tiled ones need whole tiles.
+    LgBlock = layout_is_blocked(layout) ? LG_B : 0;
+    BlockLow = (1 << LgBlock) - 1;
+    int round = layout_is_blocked(layout) ? BLOCK_DIM : 2;
+    Xsep = (x_sep + round - 1) / round * round;
+    Ysep = (y_sep + round - 1) / round * round;
+    TStride = layout_is_outer(layout) ? Xsep * Ysep : 1;
+    XStride = layout_is_outer(layout) ? 1 : 2;
+    YStride = XStride * (layout_is_blocked(layout) ? BLOCK_DIM : Xsep);
+  }
+
+  // Allocates the buffers for cap cells per time plane and rows rows.
+  void allocate(size_t cap, int rows, bool zero_init) {
+    capacity = cap;
+    row_capacity = rows;
+    if (zero_init) {
+      if (precision == PREC_DOUBLE)
+        u = (double *) calloc(cap * 2, sizeof(double));
+      else
+        uf = (float *) calloc(cap * 2, sizeof(float));
+      raster = (char *) calloc(cap, sizeof(char));
+    } else {
+      if (precision == PREC_DOUBLE)
+        u = (double *) malloc(cap * 2 * sizeof(double));
+      else
+        uf = (float *) malloc(cap * 2 * sizeof(float));
+      raster = (char *) malloc(cap * sizeof(char));
+    }
+    heat_row = (int *) calloc(rows + 1, sizeof(int));
+    raster_dirty_cap = int(cap / 8) + 1;
+    raster_dirty = (int *) malloc(raster_dirty_cap * sizeof(int));
+    raster_mark = (uint16_t *) calloc(cap, sizeof(uint16_t));
+    raster_span = (int *) malloc(2 * rows * sizeof(int));
+  }
+
+  void release() {
+    free(u);
+    free(uf);
+    free(raster);
+    free(heat_row);
+    free(heat_runs);
+    free(raster_dirty);
+    free(raster_mark);
+    free(raster_span);
+    u = nullptr;
+    uf = nullptr;
+    heat_runs = nullptr;
+    heat_cap = 0;
+    heat_nruns = 0;
+  }
+
+public:
+
   // Takes values of X, Y, and TStep from params,
   // and sets appropriate values in Q.
   void set_sim_size(int X, int Y, int TStep) {
@@ -166,7 +580,7 @@ public:
     CY = alpha * DT / (DY * DY);
   }
 
-  // Applies the kernel for a single timestep.
+  // Applies the kernel for a single timestep, to a PREC_DOUBLE state.
   void kernel_inline(int t, int x, int y) const {
     if (x == 0 || x == X - 1 || y == 0 || y == Y - 1) {
       U(this, t + 1, x, y) = 0.0;
@@ -183,53 +597,273 @@ public:
   void null_kernel(int t, int x, int y) const {
     U(this, t + 1, x, y) += heat_inc * Raster(this, y, x);
   }
+};
 
-  void rect_null(int t0, int t1,
-                 int x0, int x1,
-                 int my_y0, int my_y1) const {
-    for (int t = t0; t < t1; t++) {
-      for (int x = x0; x < x1; x++) {
-        int y;
-        for (y = my_y0; y + 7 < my_y1; y += 8) {
-          null_kernel(t, x, y);
-          null_kernel(t, x, y + 1);
-          null_kernel(t, x, y + 2);
-          null_kernel(t, x, y + 3);
-          null_kernel(t, x, y + 4);
-          null_kernel(t, x, y + 5);
-          null_kernel(t, x, y + 6);
-          null_kernel(t, x, y + 7);
-        }
-        for (; y < my_y1; y++) {
-          null_kernel(t, x, y);
-        }
+template<>
+inline double *SimState::data<double>() const {
+  return u;
+}
+
+template<>
+inline float *SimState::data<float>() const {
+  return uf;
+}
+
+// Typed view of a SimState whose layout, and with it the tiling and the
+// x and t strides, is fixed at compile time, as is the precision: values
+// are stored as Real and computed in Acc.  The walkers are instantiated
+// over every SimView (see with_sim_view), so the base case indexes with
+// constants and with copies of Q's fields, which the compiler can keep in
+// registers, instead of going through the Idx macros and Q.
+template<typename Real, SimLayout Layout, typename Acc = Real,
+         int LgBlock = layout_is_blocked(Layout) ? LG_B : 0>
+class SimView {
+public:
+  static constexpr bool Outer = layout_is_outer(Layout);
+  static constexpr int XStride = Outer ? 1 : 2;
+  static constexpr int BlockLow = (1 << LgBlock) - 1;
+
+  Real *u;
+  const char *raster;
+  int X, Y;
+  int Xsep;
+  ptrdiff_t Plane;  // Distance between the time planes, if Outer.
+  Acc alpha, CX, CY;
+  float heat_inc;
+  bool heat_sparse;
+  const int *heat_row;
+  const HeatRun *heat_runs;
+  const OutputSink *output;
+  const ChangeSink *changes;
+  WalkParams walk;
+
+  explicit SimView(const SimState *Q)
+      : u(Q->data<Real>()), raster(Q->raster), X(Q->X), Y(Q->Y), Xsep(Q->Xsep),
+        Plane(ptrdiff_t(Q->Xsep) * Q->Ysep), alpha(Acc(::alpha)), CX(Acc(Q->CX)),
+        CY(Acc(Q->CY)), heat_inc(Q->heat_inc), heat_sparse(Q->heat_sparse),
+        heat_row(Q->heat_row), heat_runs(Q->heat_runs), output(Q->output),
+        changes(Q->changes), walk(Q->walk) {
+    assert(u && Q->layout == Layout && Q->LgBlock == LgBlock);
+  }
+
+  // Same as CellOffset.
+  ptrdiff_t cell(int x, int y) const {
+    if (LgBlock == 0)
+      return ptrdiff_t(Xsep) * y + x;
+    return ptrdiff_t(Xsep) * (y & ~BlockLow) + ((x & ~BlockLow) << LgBlock)
+           + ((y & BlockLow) << LgBlock) + (x & BlockLow);
+  }
+
+  // Same as Idx.
+  ptrdiff_t idx(int t, int x, int y) const {
+    return (Outer ? Plane : 1) * (t & 1) + XStride * cell(x, y);
+  }
+
+  // Applies the kernel for a single timestep; same as SimState::kernel_inline.
+  void kernel_inline(int t, int x, int y) const {
+    Real *dst = u + idx(t + 1, x, y);
+    if (x == 0 || x == X - 1 || y == 0 || y == Y - 1) {
+      *dst = 0.0;
+    } else {
+      const Real *src = u + idx(t, x, y);
+      stencil_cell(dst, src, idx(t, x + 1, y) - idx(t, x, y), idx(t, x, y) - idx(t, x - 1, y),
+                   idx(t, x, y + 1) - idx(t, x, y), idx(t, x, y) - idx(t, x, y - 1),
+                   alpha, CX, CY);
+    }
+
+    // add the heat
+    *dst = Real(Acc(*dst) + Acc(heat_inc * raster[cell(x, y)]));
+  }
+
+  // Applies the kernel to a cell on the boundary of the grid, which holds
+  // only the heat added to it.
+  void kernel_boundary(int t, int x, int y) const {
+    Real *dst = u + idx(t + 1, x, y);
+    if (heat_sparse)
+      *dst = 0.0;
+    else
+      *dst = Real(Acc(0.0) + Acc(heat_inc * raster[cell(x, y)]));
+  }
+
+  // Adds the heat of the runs of row y that overlap [x0, x1).  Cells
+  // outside the runs would only get zero added.
+  void add_heat_runs(int t, int y, int x0, int x1) const {
+    for (int r = heat_row[y]; r < heat_row[y + 1] && heat_runs[r].x0 < x1; ++r) {
+      Acc h = Acc(heat_inc * heat_runs[r].value);
+      for (int x = max(x0, heat_runs[r].x0); x < min(x1, heat_runs[r].x1); ++x) {
+        Real *dst = u + idx(t + 1, x, y);
+        *dst = Real(Acc(*dst) + h);
       }
     }
   }
-  // Jim: This is only here because Cilk++ crashes if LG_B > 1
-  // In this case, we use the more complicated indexing macro, and
-  // maybe Cilk++ can not inline that much?
-#if (LG_B == 1)
-#define kernel kernel_inline
-#else
-  static void kernel_no_inline(int t, int x, int y) {
-    kernel_inline(t, x, y);
+
+  void null_kernel(int t, int x, int y) const {
+    Real *dst = u + idx(t + 1, x, y);
+    *dst = Real(Acc(*dst) + Acc(heat_inc * raster[cell(x, y)]));
   }
-#define kernel kernel_no_inline
-#endif
 
-  void kernel_single_timestep(int t, int my_x0, int my_x1, int my_y0, int my_y1) const {
-    for (int x = my_x0; x < my_x1; ++x) {
-      for (int y = my_y0; y < my_y1; ++y) {
-        kernel(t, x, y);
+  // Applies the interior stencil, and adds the heat unless heat_sparse, to
+  // cells [x0, x1) of interior row y, which must lie within one tile row.
+  // The first cell's x-1 neighbor is xp elements before it and the last
+  // cell's x+1 neighbor xn elements after it; all other x-neighbors are
+  // XStride apart.
+  void kernel_span(int t, int y, int x0, int x1, ptrdiff_t xn, ptrdiff_t xp,
+                   ptrdiff_t yn, ptrdiff_t yp) const {
+    Real *dst = u + idx(t + 1, x0, y);
+    const Real *src = u + idx(t, x0, y);
+    int n = x1 - x0;
+    int a = 0, b = n;
+    if (xp != XStride) {
+      stencil_cell(dst, src, n == 1 ? xn : XStride, xp, yn, yp, alpha, CX, CY);
+      ++a;
+    }
+    if (xn != XStride && a < b) {
+      --b;
+      stencil_cell(dst + XStride * b, src + XStride * b, xn, XStride, yn, yp, alpha, CX, CY);
+    }
+    stencil_row<XStride>(dst + XStride * a, src + XStride * a, yn, yp, b - a, alpha, CX, CY);
+    if (heat_sparse)
+      return;
+    // add the heat
+    const char *heat = raster + cell(x0, y);
+    for (int i = 0; i < n; ++i)
+      dst[XStride * i] = Real(Acc(dst[XStride * i]) + Acc(heat_inc * heat[i]));
+  }
+
+  // Applies the kernel for a single timestep to cells [x0, x1) of row y.
+  // With sparse heat, the stencil pass leaves out the heat, which is then
+  // added from the runs of the row.
+  void kernel_row(int t, int y, int x0, int x1) const {
+    kernel_row_stencil(t, y, x0, x1);
+    if (heat_sparse)
+      add_heat_runs(t, y, x0, x1);
+    if (output && t + 1 == output->t)
+      output_row(output, t + 1, y, x0, x1);
+    if (changes && t + 1 == changes->t)
+      record_changes(changes, t + 1, y, x0, x1);
+  }
+
+  // Boundary rows and columns are peeled off into kernel_boundary, so the
+  // interior of the row runs through the vectorized stencil_row, one tile
+  // at a time in the blocked layouts, without any per-cell tests.
+  void kernel_row_stencil(int t, int y, int x0, int x1) const {
+    if (x0 >= x1)
+      return;
+    if (y == 0 || y == Y - 1) {
+      for (int x = x0; x < x1; ++x)
+        kernel_boundary(t, x, y);
+      return;
+    }
+    if (x0 == 0)
+      kernel_boundary(t, x0++, y);
+    if (x1 == X)
+      kernel_boundary(t, --x1, y);
+    if (x0 >= x1)
+      return;
+    // The distance to the rows above and below is the same for every cell
+    // of a row, but differs between the two at the edge of a tile.
+    ptrdiff_t yn = idx(t, x0, y + 1) - idx(t, x0, y);
+    ptrdiff_t yp = idx(t, x0, y) - idx(t, x0, y - 1);
+    if (BlockLow == 0) {
+      kernel_span(t, y, x0, x1, XStride, XStride, yn, yp);
+      return;
+    }
+    // Distance between the last cell of a tile row and the first cell of
+    // the same row in the next tile.
+    const ptrdiff_t xt = ptrdiff_t(XStride) * (BlockLow * (BlockLow + 1) + 1);
+    while (x0 < x1) {
+      int end = min(x1, (x0 | BlockLow) + 1);
+      kernel_span(t, y, x0, end,
+                  (end & BlockLow) == 0 ? xt : XStride,
+                  (x0 & BlockLow) == 0 ? xt : XStride, yn, yp);
+      x0 = end;
+    }
+  }
+
+  // Calls f(i, src, n) for each span of cells [x0, x1) of row y at time t
+  // that is stored with a constant stride of XStride: cells x0 + i to
+  // x0 + i + n, starting at src.  That is the whole range, except in the
+  // blocked layouts, where it is one span per tile.
+  template<typename F>
+  void row_spans(int t, int y, int x0, int x1, F f) const {
+    for (int i = 0; x0 + i < x1;) {
+      int x = x0 + i;
+      int end = BlockLow == 0 ? x1 : min(x1, (x | BlockLow) + 1);
+      f(i, u + idx(t, x, y), end - x);
+      i = end - x0;
+    }
+  }
+
+  // Converts cells [x0, x1) of row y at time t to consecutive RGBA pixels
+  // at dst (see to_rgba).
+  void rgba_row(int t, int y, int x0, int x1, unsigned char *dst) const {
+    row_spans(t, y, x0, x1, [dst](int i, const Real *src, int n) {
+      to_rgba<XStride>(dst + 4 * i, src, n);
+    });
+  }
+
+  // Converts cells [x0, x1) of row y at time t to out's format, at their
+  // place in out.
+  void output_row(const OutputSink *out, int t, int y, int x0, int x1) const {
+    unsigned char *row = out->dst + out->pitch * y;
+    switch (out->format) {
+      case OUT_RGBA:
+        rgba_row(t, y, x0, x1, row + 4 * x0);
+        break;
+      case OUT_HALF:
+        row_spans(t, y, x0, x1, [row, x0](int i, const Real *src, int n) {
+          to_half<XStride>((uint16_t *) row + x0 + i, src, n);
+        });
+        break;
+      case OUT_FLOAT:
+        row_spans(t, y, x0, x1, [row, x0](int i, const Real *src, int n) {
+          to_float<XStride>((float *) row + x0 + i, src, n);
+        });
+        break;
+      case OUT_LUMINANCE:
+        row_spans(t, y, x0, x1, [row, x0](int i, const Real *src, int n) {
+          to_luminance<XStride>(row + x0 + i, src, n);
+        });
+        break;
+    }
+  }
+
+  // Compares the codes of cells [x0, x1) of row y at time t with those in
+  // c, records them, and flags the tiles where any differed.  Strands of
+  // the same tile may flag it at once, so the flags are stored atomically.
+  void record_changes(const ChangeSink *c, int t, int y, int x0, int x1) const {
+    uint16_t *code = c->codes + size_t(y) * c->pitch;
+    uint8_t *flags = c->changed + size_t(y / c->tile) * c->tiles_x;
+    row_spans(t, y, x0, x1, [&](int i, const Real *src, int n) {
+      int x = x0 + i;
+      for (int k = 0; k < n;) {
+        int tx = (x + k) / c->tile;
+        int end = min(n, (tx + 1) * c->tile - x);
+        bool changed = false;
+        for (; k < end; ++k) {
+          uint16_t q = color_code(float(src[XStride * k]));
+          changed |= q != code[x + k];
+          code[x + k] = q;
+        }
+        if (changed)
+          __atomic_store_n(flags + tx, uint8_t(1), __ATOMIC_RELAXED);
       }
+    });
+  }
+
+  void kernel_single_timestep(int t, int my_x0, int my_x1, int my_y0, int my_y1) const {
+    // Work on a local copy, which stores through u cannot alias.
+    const SimView Q = *this;
+    for (int y = my_y0; y < my_y1; ++y) {
+      Q.kernel_row(t, y, my_x0, my_x1);
     }
   }
 
   void base_case_kernel(int t0, int t1, int x0, int dx0, int x1,
                         int dx1, int y0, int dy0, int y1, int dy1) const {
+    const SimView Q = *this;
     for (int t = t0; t < t1; t++) {
-      kernel_single_timestep(t, x0, x1, y0, y1);
+      Q.kernel_single_timestep(t, x0, x1, y0, y1);
       /* because the shape is trapezoid */
       x0 += dx0;
       x1 += dx1;
@@ -239,4 +873,46 @@ public:
   }
 };
 
+// Calls f with a pointer to the SimView of Q's layout, with values stored as
+// Real and computed in Acc.
+template<typename Real, typename Acc, class F>
+static inline void with_sim_view_layout(const SimState *Q, F &&f) {
+  switch (Q->layout) {
+    case LAYOUT_TIME_INNER: {
+      const SimView<Real, LAYOUT_TIME_INNER, Acc> V(Q);
+      f(&V);
+      break;
+    }
+    case LAYOUT_TIME_OUTER: {
+      const SimView<Real, LAYOUT_TIME_OUTER, Acc> V(Q);
+      f(&V);
+      break;
+    }
+    case LAYOUT_BLOCKED: {
+      const SimView<Real, LAYOUT_BLOCKED, Acc> V(Q);
+      f(&V);
+      break;
+    }
+    case LAYOUT_BLOCKED_OUTER: {
+      const SimView<Real, LAYOUT_BLOCKED_OUTER, Acc> V(Q);
+      f(&V);
+      break;
+    }
+    default:
+      assert(false && "unknown layout");
+  }
+}
+
+// Calls f with a pointer to the SimView of Q's layout and precision.
+template<class F>
+static inline void with_sim_view(const SimState *Q, F &&f) {
+  switch (Q->precision) {
+    case PREC_DOUBLE: with_sim_view_layout<double, double>(Q, f); break;
+    case PREC_FLOAT: with_sim_view_layout<float, float>(Q, f); break;
+    case PREC_MIXED: with_sim_view_layout<float, double>(Q, f); break;
+    default:
+      assert(false && "unknown precision");
+  }
+}
+
 #endif //CILKHEATDEMO2_SIM_H
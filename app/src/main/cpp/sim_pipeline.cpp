@@ -0,0 +1,177 @@
+/* Simulation thread that runs ahead of the renderer.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <chrono>
+#include "sim_pipeline.h"
+#include "frame_stats.h"
+
+// A state with Q's size, layout, precision and walker cutoffs, zeroed.
+static SimState *new_like(const SimState *Q) {
+  SimState *S = new SimState(Q->X, Q->Y, true, Q->layout, Q->precision);
+  S->set_sim_size(Q->X, Q->Y, Q->TStep);
+  S->walk = Q->walk;
+  return S;
+}
+
+SimPipeline::SimPipeline(const SimState *Q0, long t, const Algorithm *algorithm)
+    : Q(new_like(Q0)), t(t), algorithm(algorithm) {
+  Q->copy_from(Q0);
+  tiles.reset(Q->X, Q->Y);
+  int n = tiles.count();
+  changed_at = (long *) calloc(n, sizeof(long));
+  for (Snapshot &s : slots) {
+    s.Q = new_like(Q0);
+    s.changed_at = (long *) calloc(n, sizeof(long));
+  }
+  pending.row = (int *) calloc(Q->Y + 1, sizeof(int));
+  applied.row = (int *) calloc(Q->Y + 1, sizeof(int));
+  thread = std::thread([this] { run(); });
+}
+
+SimPipeline::~SimPipeline() {
+  if (thread.joinable()) {
+    stopping.store(true, std::memory_order_release);
+    thread.join();
+  }
+  delete Q;
+  free(changed_at);
+  for (Snapshot &s : slots) {
+    delete s.Q;
+    free(s.changed_at);
+  }
+  for (Heat *h : {&pending, &applied}) {
+    free(h->row);
+    free(h->runs);
+  }
+}
+
+void SimPipeline::set_heat(const SimState *src) {
+  uint64_t now = now_ns();
+  std::lock_guard<std::mutex> lock(heat_mu);
+  Heat &h = pending;
+  if (h.cap < src->heat_nruns) {
+    h.cap = max(src->heat_nruns, 2 * h.cap);
+    h.runs = (HeatRun *) realloc(h.runs, h.cap * sizeof(HeatRun));
+  }
+  memcpy(h.row, src->heat_row, (src->Y + 1) * sizeof(int));
+  memcpy(h.runs, src->heat_runs, src->heat_nruns * sizeof(HeatRun));
+  h.nruns = src->heat_nruns;
+  h.heat_inc = src->heat_inc;
+  h.ns = now;
+  ++pending_seq;
+}
+
+// Redraws Q's raster from the newest heat handed over, if it is new.
+void SimPipeline::take_heat() {
+  {
+    std::lock_guard<std::mutex> lock(heat_mu);
+    if (pending_seq == applied_seq)
+      return;
+    std::swap(pending, applied);
+    applied_seq = pending_seq;
+  }
+  Q->clear_raster();
+  for (int y = 0; y < Q->Y; ++y) {
+    for (int r = applied.row[y]; r < applied.row[y + 1]; ++r) {
+      const HeatRun &run = applied.runs[r];
+      for (int x = run.x0; x < run.x1; ++x)
+        Q->set_raster(x, y, run.value);
+    }
+  }
+  Q->heat_inc = applied.heat_inc;
+  Q->update_heat_dirty();
+}
+
+void SimPipeline::run() {
+  int n = tiles.count();
+  uint64_t last = now_ns();
+  while (!stopping.load(std::memory_order_acquire)) {
+    uint64_t now = now_ns();
+    if (now - last < PIPELINE_CHUNK_NS) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(PIPELINE_CHUNK_NS - (now - last)));
+      continue;
+    }
+    take_heat();
+    int tstep = int(float(now - last) * REAL_TIME_PER_TSTEP);
+    tstep = min(max(1, tstep), DEFAULT_TSTEP);
+    last = now;
+    const Algorithm *a = algorithm.load(std::memory_order_relaxed);
+    // Tiles whose codes the algorithm cannot follow all change, and their
+    // codes are then unknown.
+    bool tracked = a->flags & ALG_FUSED_OUTPUT;
+    ChangeSink changes = tiles.track(t + tstep);
+    Q->changes = tracked ? &changes : nullptr;
+    a->fn(Q, t, t + tstep, 0, Q->X, 0, Q->Y);
+    Q->changes = nullptr;
+    t += tstep;
+    if (!tracked)
+      tiles.forget();
+    for (int i = 0; i < n; ++i)
+      if (!tracked || tiles.is_changed(i))
+        changed_at[i] = t;
+    publish();
+  }
+}
+
+void SimPipeline::publish() {
+  Snapshot &s = slots[back];
+  s.Q->copy_plane_from(Q, t);
+  s.t = t;
+  s.done_ns = now_ns();
+  s.input_ns = applied.ns;
+  memcpy(s.changed_at, changed_at, tiles.count() * sizeof(long));
+  back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+  npublished.fetch_add(1, std::memory_order_relaxed);
+}
+
+const SimPipeline::Snapshot *SimPipeline::acquire() {
+  if (!(middle.load(std::memory_order_relaxed) & FRESH))
+    return nullptr;
+  front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+  const Snapshot &s = slots[front];
+  uint64_t now = now_ns();
+  float age = float(now - s.done_ns) * 1e-6f;
+  float input = s.input_ns ? float(now - s.input_ns) * 1e-6f : 0.0f;
+  // Weights of 1/16 average over about the last second of frames.
+  float w = st.acquired == 0 ? 1.0f : 1.0f / 16;
+  st.age_ms += w * (age - st.age_ms);
+  st.input_ms += w * (input - st.input_ms);
+  st.age_max_ms = max(st.age_max_ms, age);
+  st.input_max_ms = max(st.input_max_ms, input);
+  ++st.acquired;
+  return &s;
+}
+
+SimPipeline::Stats SimPipeline::stats() {
+  Stats s = st;
+  s.published = npublished.load(std::memory_order_relaxed);
+  st.age_max_ms = 0;
+  st.input_max_ms = 0;
+  return s;
+}
+
+long SimPipeline::finish(SimState *Q0) {
+  stopping.store(true, std::memory_order_release);
+  thread.join();
+  Q0->copy_plane_from(Q, t);
+  return t;
+}
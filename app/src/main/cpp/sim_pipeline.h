@@ -0,0 +1,134 @@
+/* Simulation thread that runs ahead of the renderer.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_SIM_PIPELINE_H
+#define CILKHEATDEMO2_SIM_PIPELINE_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "common.h"
+#include "sim.h"
+#include "algorithms.h"
+#include "dirty_tiles.h"
+
+// Wall time that the simulation thread lets pass between steps, so that
+// it publishes a few snapshots per display frame rather than one per
+// timestep.
+#define PIPELINE_CHUNK_NS 4000000
+
+// Runs the simulation on its own thread, a Cilk root of its own, while the
+// GL thread draws.  The thread advances the grid by as many timesteps as
+// wall time calls for (as Renderer::step does) and publishes each result
+// as a snapshot of the current time plane into a triple buffer: one
+// snapshot being written, one waiting, and one being drawn, so that
+// neither thread ever waits for the other.  Heat sources go the other way
+// under a mutex, as heat runs, and apply from the next step on.
+//
+// Every method is called on the GL thread.
+class SimPipeline {
+public:
+  struct Snapshot {
+    SimState *Q;        // Holds the grid at time t; nothing else.
+    long t;
+    uint64_t done_ns;   // When the step that produced it finished.
+    uint64_t input_ns;  // When the newest heat it includes was handed over.
+    // Last time at which the codes of each DirtyTiles tile changed (see
+    // DirtyTiles::plan_changed).
+    long *changed_at;
+  };
+
+  // Latencies, in milliseconds, seen by acquire: the age of each snapshot
+  // when it was acquired, and the time from handing over the newest heat
+  // it includes.  Means are exponentially weighted; maxima are since the
+  // previous call to stats.
+  struct Stats {
+    float age_ms, age_max_ms;
+    float input_ms, input_max_ms;
+    uint64_t published, acquired;
+  };
+
+  // Starts the simulation from Q's grid at time t and its heat sources.
+  SimPipeline(const SimState *Q, long t, const Algorithm *algorithm);
+
+  // Stops the thread.
+  ~SimPipeline();
+
+  // Hands over the heat runs and heat_inc of Q.
+  void set_heat(const SimState *Q);
+
+  void set_algorithm(const Algorithm *a) {
+    algorithm.store(a, std::memory_order_relaxed);
+  }
+
+  // Returns the newest snapshot that was not returned before, or nullptr.
+  // It stays valid until the next call.
+  const Snapshot *acquire();
+
+  Stats stats();
+
+  // Stops the thread and copies the newest grid into Q, which must be
+  // allocated like the one passed to the constructor; returns its time.
+  long finish(SimState *Q);
+
+private:
+  // Index into slots, with FRESH set in middle while its slot has not
+  // been acquired.
+  static constexpr int FRESH = 4;
+
+  // Heat runs handed over by set_heat, in the form of SimState's.
+  struct Heat {
+    int *row = nullptr;  // Y + 1 entries
+    HeatRun *runs = nullptr;
+    int nruns = 0, cap = 0;
+    float heat_inc = 0;
+    uint64_t ns = 0;
+  };
+
+  void run();
+  void take_heat();
+  void publish();
+
+  SimState *Q;  // The simulation thread's grid.
+  long t;
+  std::atomic<const Algorithm *> algorithm;
+  std::atomic<bool> stopping{false};
+  std::thread thread;
+
+  Snapshot slots[3]{};
+  int back = 0, front = 1;  // Owned by the simulation and GL threads.
+  std::atomic<int> middle{2};
+
+  std::mutex heat_mu;
+  Heat pending, applied;   // pending is guarded by heat_mu.
+  uint64_t pending_seq = 0, applied_seq = 0;
+  // Codes of the simulation thread's grid, and the last time at which
+  // each tile's changed.
+  DirtyTiles tiles;
+  long *changed_at = nullptr;
+
+  Stats st{};
+  std::atomic<uint64_t> npublished{0};
+};
+
+#endif  // CILKHEATDEMO2_SIM_PIPELINE_H
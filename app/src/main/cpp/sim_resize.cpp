@@ -0,0 +1,66 @@
+/* Resizing a simulation while keeping its temperature field.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <type_traits>
+#include "sim_resize.h"
+
+void resize_sim(SimState *Q, long t, int X, int Y, ResizeScratch *scratch) {
+  int X0 = Q->X, Y0 = Q->Y;
+  with_sim_view(Q, [&](auto *V) {
+    using Acc = decltype(V->alpha);
+    size_t n = size_t(X0) * Y0 * sizeof(Acc);
+    if (n > scratch->capacity) {
+      free(scratch->values);
+      scratch->capacity = n + size_t(n * RESHAPE_SLACK);
+      scratch->values = malloc(scratch->capacity);
+    }
+    Acc *old = (Acc *) scratch->values;
+    cilk_for (int y = 0; y < Y0; ++y)
+      for (int x = 0; x < X0; ++x)
+        old[size_t(y) * X0 + x] = Acc(V->u[V->idx(int(t), x, y)]);
+  });
+
+  Q->reshape(X, Y);
+  Q->set_sim_size(X, Y, Q->TStep);
+  with_sim_view(Q, [&](auto *V) {
+    using Real = typename std::remove_pointer<decltype(V->u)>::type;
+    using Acc = decltype(V->alpha);
+    const Acc *old = (const Acc *) scratch->values;
+    // Cell centers of the new grid in the old one's coordinates.
+    Acc sx = Acc(X0) / X, sy = Acc(Y0) / Y;
+    cilk_for (int y = 0; y < Y; ++y) {
+      Acc fy = min(max((y + Acc(0.5)) * sy - Acc(0.5), Acc(0)), Acc(Y0 - 1));
+      int y0 = min(int(fy), Y0 - 1), y1 = min(y0 + 1, Y0 - 1);
+      Acc wy = fy - y0;
+      const Acc *r0 = old + size_t(y0) * X0, *r1 = old + size_t(y1) * X0;
+      for (int x = 0; x < X; ++x) {
+        Acc fx = min(max((x + Acc(0.5)) * sx - Acc(0.5), Acc(0)), Acc(X0 - 1));
+        int x0 = min(int(fx), X0 - 1), x1 = min(x0 + 1, X0 - 1);
+        Acc wx = fx - x0;
+        Acc top = r0[x0] + wx * (r0[x1] - r0[x0]);
+        Acc bottom = r1[x0] + wx * (r1[x1] - r1[x0]);
+        V->u[V->idx(int(t), x, y)] = Real(top + wy * (bottom - top));
+      }
+    }
+  });
+}
@@ -0,0 +1,49 @@
+/* Resizing a simulation while keeping its temperature field.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef CILKHEATDEMO2_SIM_RESIZE_H
+#define CILKHEATDEMO2_SIM_RESIZE_H
+
+#include "common.h"
+#include "sim.h"
+
+// Grow-only scratch that holds one time plane across a resize, in the
+// accumulation type of the state being resized.
+struct ResizeScratch {
+  void *values = nullptr;
+  size_t capacity = 0;  // In bytes.
+
+  ~ResizeScratch() {
+    free(values);
+  }
+};
+
+// Makes Q an X by Y grid (see SimState::reshape) whose time plane t is
+// plane t of the old grid resampled bilinearly, with the old and new grids
+// stretched over the same area; the cells of the old plane pass through
+// scratch and are interpolated in the state's accumulation type, so a
+// double grid is not rounded to float.  Rows are resampled in parallel.
+// The raster and heat sources come back empty, and TStep is kept.
+void resize_sim(SimState *Q, long t, int X, int Y, ResizeScratch *scratch);
+
+#endif  // CILKHEATDEMO2_SIM_RESIZE_H
@@ -0,0 +1,514 @@
+/* Vectorized row kernel for the 5-point heat stencil.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_SIMD_H
+#define CILKHEATDEMO2_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// The instruction set is picked at compile time: AVX2 or SSE2 on x86,
+// NEON on AArch64, and otherwise (or with HEAT_NO_SIMD) a portable version
+// that the compiler may auto-vectorize.
+#if defined(HEAT_NO_SIMD)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define HEAT_SIMD_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HEAT_SIMD_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HEAT_SIMD_NEON 1
+#endif
+
+// Vectors of doubles (VecD) and floats (VecF).  load/store access W
+// elements that are S elements apart, S = 1 (contiguous) or S = 2 (one time
+// plane of the interleaved LAYOUT_TIME_INNER).  Strided accesses
+// touch only the elements themselves: a wide load that also covered the
+// other time plane would overlap the previous iteration's stores (stalling
+// store-to-load forwarding) and race with neighboring strands writing that
+// plane.  VecD can also load and store floats, converting on the way, for
+// float storage with double arithmetic.  VecD::store_rgba truncates three
+// vectors of color components in [0, 255] to bytes and stores them as W
+// RGBA pixels with alpha 1 (the SIMD versions assume a little-endian
+// target, as all of them are).
+#if HEAT_SIMD_AVX2
+struct VecD {
+  static const int W = 4;
+  __m256d v;
+
+  template<int S>
+  static VecD load(const double *p) {
+    if (S == 1)
+      return {_mm256_loadu_pd(p)};
+    __m128d lo = _mm_loadh_pd(_mm_load_sd(p), p + 2);
+    __m128d hi = _mm_loadh_pd(_mm_load_sd(p + 4), p + 6);
+    return {_mm256_insertf128_pd(_mm256_castpd128_pd256(lo), hi, 1)};
+  }
+  template<int S>
+  static void store(double *p, VecD a) {
+    if (S == 1) {
+      _mm256_storeu_pd(p, a.v);
+      return;
+    }
+    __m128d lo = _mm256_castpd256_pd128(a.v);
+    __m128d hi = _mm256_extractf128_pd(a.v, 1);
+    _mm_store_sd(p, lo);
+    _mm_storeh_pd(p + 2, lo);
+    _mm_store_sd(p + 4, hi);
+    _mm_storeh_pd(p + 6, hi);
+  }
+  template<int S>
+  static VecD load(const float *p) {
+    if (S == 1)
+      return {_mm256_cvtps_pd(_mm_loadu_ps(p))};
+    return {_mm256_cvtps_pd(_mm_setr_ps(p[0], p[2], p[4], p[6]))};
+  }
+  template<int S>
+  static void store(float *p, VecD a) {
+    __m128 f = _mm256_cvtpd_ps(a.v);
+    if (S == 1) {
+      _mm_storeu_ps(p, f);
+      return;
+    }
+    alignas(16) float r[W];
+    _mm_store_ps(r, f);
+    for (int i = 0; i < W; ++i) p[2 * i] = r[i];
+  }
+  static VecD set1(double a) { return {_mm256_set1_pd(a)}; }
+  static VecD add(VecD a, VecD b) { return {_mm256_add_pd(a.v, b.v)}; }
+  static VecD sub(VecD a, VecD b) { return {_mm256_sub_pd(a.v, b.v)}; }
+  static VecD mul(VecD a, VecD b) { return {_mm256_mul_pd(a.v, b.v)}; }
+  static VecD clamp(VecD a, VecD lo, VecD hi) {
+    return {_mm256_max_pd(lo.v, _mm256_min_pd(a.v, hi.v))};
+  }
+  static void store_rgba(unsigned char *p, VecD r, VecD g, VecD b) {
+    __m128i px = _mm_or_si128(
+        _mm_or_si128(_mm256_cvttpd_epi32(r.v), _mm_slli_epi32(_mm256_cvttpd_epi32(g.v), 8)),
+        _mm_or_si128(_mm_slli_epi32(_mm256_cvttpd_epi32(b.v), 16), _mm_set1_epi32(1 << 24)));
+    _mm_storeu_si128((__m128i *) p, px);
+  }
+};
+
+struct VecF {
+  static const int W = 8;
+  __m256 v;
+
+  template<int S>
+  static VecF load(const float *p) {
+    if (S == 1)
+      return {_mm256_loadu_ps(p)};
+    return {_mm256_setr_ps(p[0], p[2], p[4], p[6], p[8], p[10], p[12], p[14])};
+  }
+  template<int S>
+  static void store(float *p, VecF a) {
+    if (S == 1) {
+      _mm256_storeu_ps(p, a.v);
+      return;
+    }
+    alignas(32) float r[W];
+    _mm256_store_ps(r, a.v);
+    for (int i = 0; i < W; ++i) p[2 * i] = r[i];
+  }
+  static VecF set1(float a) { return {_mm256_set1_ps(a)}; }
+  static VecF add(VecF a, VecF b) { return {_mm256_add_ps(a.v, b.v)}; }
+  static VecF sub(VecF a, VecF b) { return {_mm256_sub_ps(a.v, b.v)}; }
+  static VecF mul(VecF a, VecF b) { return {_mm256_mul_ps(a.v, b.v)}; }
+};
+#elif HEAT_SIMD_SSE2
+struct VecD {
+  static const int W = 2;
+  __m128d v;
+
+  template<int S>
+  static VecD load(const double *p) {
+    if (S == 1)
+      return {_mm_loadu_pd(p)};
+    return {_mm_loadh_pd(_mm_load_sd(p), p + 2)};
+  }
+  template<int S>
+  static void store(double *p, VecD a) {
+    if (S == 1) {
+      _mm_storeu_pd(p, a.v);
+      return;
+    }
+    _mm_store_sd(p, a.v);
+    _mm_storeh_pd(p + 2, a.v);
+  }
+  template<int S>
+  static VecD load(const float *p) {
+    if (S == 1)
+      return {_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i *) p)))};
+    return {_mm_cvtps_pd(_mm_setr_ps(p[0], p[2], 0.0f, 0.0f))};
+  }
+  template<int S>
+  static void store(float *p, VecD a) {
+    __m128 f = _mm_cvtpd_ps(a.v);
+    if (S == 1) {
+      _mm_storel_epi64((__m128i *) p, _mm_castps_si128(f));
+      return;
+    }
+    p[0] = _mm_cvtss_f32(f);
+    p[2] = _mm_cvtss_f32(_mm_shuffle_ps(f, f, 1));
+  }
+  static VecD set1(double a) { return {_mm_set1_pd(a)}; }
+  static VecD add(VecD a, VecD b) { return {_mm_add_pd(a.v, b.v)}; }
+  static VecD sub(VecD a, VecD b) { return {_mm_sub_pd(a.v, b.v)}; }
+  static VecD mul(VecD a, VecD b) { return {_mm_mul_pd(a.v, b.v)}; }
+  static VecD clamp(VecD a, VecD lo, VecD hi) {
+    return {_mm_max_pd(lo.v, _mm_min_pd(a.v, hi.v))};
+  }
+  static void store_rgba(unsigned char *p, VecD r, VecD g, VecD b) {
+    __m128i px = _mm_or_si128(
+        _mm_or_si128(_mm_cvttpd_epi32(r.v), _mm_slli_epi32(_mm_cvttpd_epi32(g.v), 8)),
+        _mm_or_si128(_mm_slli_epi32(_mm_cvttpd_epi32(b.v), 16), _mm_set1_epi32(1 << 24)));
+    _mm_storel_epi64((__m128i *) p, px);
+  }
+};
+
+struct VecF {
+  static const int W = 4;
+  __m128 v;
+
+  template<int S>
+  static VecF load(const float *p) {
+    if (S == 1)
+      return {_mm_loadu_ps(p)};
+    return {_mm_setr_ps(p[0], p[2], p[4], p[6])};
+  }
+  template<int S>
+  static void store(float *p, VecF a) {
+    if (S == 1) {
+      _mm_storeu_ps(p, a.v);
+      return;
+    }
+    alignas(16) float r[W];
+    _mm_store_ps(r, a.v);
+    for (int i = 0; i < W; ++i) p[2 * i] = r[i];
+  }
+  static VecF set1(float a) { return {_mm_set1_ps(a)}; }
+  static VecF add(VecF a, VecF b) { return {_mm_add_ps(a.v, b.v)}; }
+  static VecF sub(VecF a, VecF b) { return {_mm_sub_ps(a.v, b.v)}; }
+  static VecF mul(VecF a, VecF b) { return {_mm_mul_ps(a.v, b.v)}; }
+};
+#elif HEAT_SIMD_NEON
+struct VecD {
+  static const int W = 2;
+  float64x2_t v;
+
+  template<int S>
+  static VecD load(const double *p) {
+    if (S == 1)
+      return {vld1q_f64(p)};
+    return {vld1q_lane_f64(p + 2, vld1q_dup_f64(p), 1)};
+  }
+  template<int S>
+  static void store(double *p, VecD a) {
+    if (S == 1) {
+      vst1q_f64(p, a.v);
+      return;
+    }
+    vst1q_lane_f64(p, a.v, 0);
+    vst1q_lane_f64(p + 2, a.v, 1);
+  }
+  template<int S>
+  static VecD load(const float *p) {
+    if (S == 1)
+      return {vcvt_f64_f32(vld1_f32(p))};
+    return {vcvt_f64_f32(vld1_lane_f32(p + 2, vld1_dup_f32(p), 1))};
+  }
+  template<int S>
+  static void store(float *p, VecD a) {
+    float32x2_t f = vcvt_f32_f64(a.v);
+    if (S == 1) {
+      vst1_f32(p, f);
+      return;
+    }
+    vst1_lane_f32(p, f, 0);
+    vst1_lane_f32(p + 2, f, 1);
+  }
+  static VecD set1(double a) { return {vdupq_n_f64(a)}; }
+  static VecD add(VecD a, VecD b) { return {vaddq_f64(a.v, b.v)}; }
+  static VecD sub(VecD a, VecD b) { return {vsubq_f64(a.v, b.v)}; }
+  static VecD mul(VecD a, VecD b) { return {vmulq_f64(a.v, b.v)}; }
+  static VecD clamp(VecD a, VecD lo, VecD hi) {
+    return {vmaxq_f64(lo.v, vminq_f64(a.v, hi.v))};
+  }
+  static void store_rgba(unsigned char *p, VecD r, VecD g, VecD b) {
+    uint32x2_t ri = vreinterpret_u32_s32(vmovn_s64(vcvtq_s64_f64(r.v)));
+    uint32x2_t gi = vreinterpret_u32_s32(vmovn_s64(vcvtq_s64_f64(g.v)));
+    uint32x2_t bi = vreinterpret_u32_s32(vmovn_s64(vcvtq_s64_f64(b.v)));
+    uint32x2_t px = vorr_u32(vorr_u32(ri, vshl_n_u32(gi, 8)),
+                             vorr_u32(vshl_n_u32(bi, 16), vdup_n_u32(1u << 24)));
+    vst1_u8(p, vreinterpret_u8_u32(px));
+  }
+};
+
+struct VecF {
+  static const int W = 4;
+  float32x4_t v;
+
+  template<int S>
+  static VecF load(const float *p) {
+    if (S == 1)
+      return {vld1q_f32(p)};
+    float32x4_t r = vld1q_dup_f32(p);
+    r = vld1q_lane_f32(p + 2, r, 1);
+    r = vld1q_lane_f32(p + 4, r, 2);
+    return {vld1q_lane_f32(p + 6, r, 3)};
+  }
+  template<int S>
+  static void store(float *p, VecF a) {
+    if (S == 1) {
+      vst1q_f32(p, a.v);
+      return;
+    }
+    vst1q_lane_f32(p, a.v, 0);
+    vst1q_lane_f32(p + 2, a.v, 1);
+    vst1q_lane_f32(p + 4, a.v, 2);
+    vst1q_lane_f32(p + 6, a.v, 3);
+  }
+  static VecF set1(float a) { return {vdupq_n_f32(a)}; }
+  static VecF add(VecF a, VecF b) { return {vaddq_f32(a.v, b.v)}; }
+  static VecF sub(VecF a, VecF b) { return {vsubq_f32(a.v, b.v)}; }
+  static VecF mul(VecF a, VecF b) { return {vmulq_f32(a.v, b.v)}; }
+};
+#else
+// Portable vector of W elements of type T.
+template<typename T, int N>
+struct VecN {
+  static const int W = N;
+  T v[W];
+
+  template<int S, typename M>
+  static VecN load(const M *p) {
+    VecN r;
+    for (int i = 0; i < W; ++i) r.v[i] = p[S * i];
+    return r;
+  }
+  template<int S, typename M>
+  static void store(M *p, VecN a) {
+    for (int i = 0; i < W; ++i) p[S * i] = M(a.v[i]);
+  }
+  static VecN set1(T a) {
+    VecN r;
+    for (int i = 0; i < W; ++i) r.v[i] = a;
+    return r;
+  }
+  static VecN add(VecN a, VecN b) {
+    for (int i = 0; i < W; ++i) a.v[i] += b.v[i];
+    return a;
+  }
+  static VecN sub(VecN a, VecN b) {
+    for (int i = 0; i < W; ++i) a.v[i] -= b.v[i];
+    return a;
+  }
+  static VecN mul(VecN a, VecN b) {
+    for (int i = 0; i < W; ++i) a.v[i] *= b.v[i];
+    return a;
+  }
+  static VecN clamp(VecN a, VecN lo, VecN hi) {
+    for (int i = 0; i < W; ++i)
+      a.v[i] = a.v[i] < lo.v[i] ? lo.v[i] : a.v[i] > hi.v[i] ? hi.v[i] : a.v[i];
+    return a;
+  }
+  static void store_rgba(unsigned char *p, VecN r, VecN g, VecN b) {
+    for (int i = 0; i < W; ++i) {
+      p[4 * i] = (unsigned char) r.v[i];
+      p[4 * i + 1] = (unsigned char) g.v[i];
+      p[4 * i + 2] = (unsigned char) b.v[i];
+      p[4 * i + 3] = 1;
+    }
+  }
+};
+typedef VecN<double, 4> VecD;
+typedef VecN<float, 8> VecF;
+#endif
+
+// Vector type for arithmetic in A.
+template<typename A> struct VecFor;
+template<> struct VecFor<double> { typedef VecD type; };
+template<> struct VecFor<float> { typedef VecF type; };
+
+// Applies the interior stencil to n consecutive cells of one row, stored
+// as T and computed in A.  src points at the first cell in time plane t,
+// dst at the same cell in plane t+1; neighbors in x are S elements apart,
+// and the neighbors at y+1 and y-1 are yn elements after and yp elements
+// before the cell (these differ when a row crosses into another tile).
+// The operations, and their order, match SimState::kernel_inline exactly
+// (builds use -ffp-contract=off), so every cell gets the same result
+// whether it lands in a vector or in the scalar tail.
+template<int S, typename T, typename A>
+static inline void stencil_row(T *dst, const T *src, ptrdiff_t yn, ptrdiff_t yp, int n,
+                               A alpha, A cx, A cy) {
+  typedef typename VecFor<A>::type V;
+  const V va = V::set1(alpha), vcx = V::set1(cx), vcy = V::set1(cy);
+  const V two = V::set1(A(2.0));
+  const T *end = src + S * ptrdiff_t(n);
+  for (; src + S * V::W <= end; src += S * V::W, dst += S * V::W) {
+    V c = V::template load<S>(src);
+    V c2 = V::mul(two, c);
+    V dx = V::add(V::sub(V::template load<S>(src + S), c2), V::template load<S>(src - S));
+    V dy = V::add(V::sub(V::template load<S>(src + yn), c2), V::template load<S>(src - yp));
+    V r = V::add(V::mul(va, V::add(V::mul(vcx, dx), V::mul(vcy, dy))), c);
+    V::template store<S>(dst, r);
+  }
+  for (; src < end; src += S, dst += S) {
+    A c = src[0];
+    dst[0] = T(alpha * (cx * (A(src[S]) - A(2.0) * c + A(src[-S]))
+                        + cy * (A(src[yn]) - A(2.0) * c + A(src[-yp])))
+               + c);
+  }
+}
+
+// Applies the interior stencil to a single cell whose neighbors at x+1 and
+// x-1 are xn elements after and xp elements before it.  Used for the cells
+// on the left and right edges of a tile.
+template<typename T, typename A>
+static inline void stencil_cell(T *dst, const T *src, ptrdiff_t xn, ptrdiff_t xp,
+                                ptrdiff_t yn, ptrdiff_t yp, A alpha, A cx, A cy) {
+  A c = src[0];
+  dst[0] = T(alpha * (cx * (A(src[xn]) - A(2.0) * c + A(src[-xp]))
+                      + cy * (A(src[yn]) - A(2.0) * c + A(src[-yp])))
+             + c);
+}
+
+// Converts a temperature to an RGBA pixel: red 255 u, green 255 (u / 2) and
+// blue 255 (1 - 0.8 u), each clamped to [0, 255] and truncated, and alpha 1.
+static inline void to_rgba_pixel(unsigned char *dst, double u) {
+  double c[3] = {255.0 * u, 255.0 * (0.5 * u), 255.0 * (1.0 - 0.8 * u)};
+  for (int k = 0; k < 3; ++k)
+    dst[k] = (unsigned char) (c[k] < 0.0 ? 0.0 : c[k] > 255.0 ? 255.0 : c[k]);
+  dst[3] = 1;
+}
+
+// 8-bit code of a temperature: the red component of to_rgba_pixel,
+// extended past 255 to follow green.  Two temperatures with the same code
+// get colors that differ by at most one step in each component.
+static inline uint16_t color_code(float u) {
+  float c = 255.0f * u;
+  return uint16_t(c < 0.0f ? 0.0f : c > 510.0f ? 510.0f : c);
+}
+
+// Converts n consecutive cells of one row, S elements apart, to n RGBA
+// pixels at dst, as to_rgba_pixel does.
+template<int S, typename T>
+static inline void to_rgba(unsigned char *dst, const T *src, int n) {
+  typedef VecD V;
+  const V zero = V::set1(0.0), full = V::set1(255.0);
+  const V half = V::set1(0.5), one = V::set1(1.0), blue = V::set1(0.8);
+  const T *end = src + S * ptrdiff_t(n);
+  for (; src + S * V::W <= end; src += S * V::W, dst += 4 * V::W) {
+    V u = V::template load<S>(src);
+    V r = V::mul(full, u);
+    V g = V::mul(full, V::mul(half, u));
+    V b = V::mul(full, V::sub(one, V::mul(blue, u)));
+    V::store_rgba(dst, V::clamp(r, zero, full), V::clamp(g, zero, full),
+                  V::clamp(b, zero, full));
+  }
+  for (; src < end; src += S, dst += 4)
+    to_rgba_pixel(dst, src[0]);
+}
+
+// Single-channel texels, for colormapping on the GPU through the palette
+// of fill_colormap.  to_luminance stores 255 (u / 2), the green component
+// of to_rgba_pixel, at half the resolution of red.
+template<int S, typename T>
+static inline void to_float(float *dst, const T *src, int n) {
+  typedef VecD V;
+  const T *end = src + S * ptrdiff_t(n);
+  for (; src + S * V::W <= end; src += S * V::W, dst += V::W)
+    V::template store<1>(dst, V::template load<S>(src));
+  for (; src < end; src += S)
+    *dst++ = float(src[0]);
+}
+
+// Rounds f to the nearest half-precision float, ties to even.
+static inline uint16_t float_to_half(float f) {
+#if defined(__aarch64__)
+  __fp16 h = (__fp16) f;
+  uint16_t r;
+  memcpy(&r, &h, sizeof(r));
+  return r;
+#elif defined(__F16C__) && HEAT_SIMD_AVX2
+  return _cvtss_sh(f, 0);
+#else
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  uint32_t sign = (x >> 16) & 0x8000;
+  int exp = int((x >> 23) & 0xff) - 127 + 15;
+  uint32_t mant = x & 0x7fffff;
+  if (((x >> 23) & 0xff) == 0xff)
+    return uint16_t(sign | 0x7c00 | (mant ? 0x200 : 0));
+  if (exp >= 31)
+    return uint16_t(sign | 0x7c00);
+  int shift = 13;
+  uint32_t h = (uint32_t(exp) << 10) | (mant >> 13);
+  if (exp <= 0) {
+    // Subnormal, with the implicit bit made explicit.
+    if (exp < -10)
+      return uint16_t(sign);
+    shift = 14 - exp;
+    mant |= 0x800000;
+    h = mant >> shift;
+  }
+  uint32_t rem = mant & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+  if (rem > halfway || (rem == halfway && (h & 1)))
+    ++h;  // May carry into the exponent, up to infinity, as it should.
+  return uint16_t(sign | h);
+#endif
+}
+
+template<int S, typename T>
+static inline void to_half(uint16_t *dst, const T *src, int n) {
+  for (int i = 0; i < n; ++i)
+    dst[i] = float_to_half(float(src[S * i]));
+}
+
+template<int S, typename T>
+static inline void to_luminance(unsigned char *dst, const T *src, int n) {
+  for (int i = 0; i < n; ++i) {
+    double g = 255.0 * (0.5 * double(src[S * i]));
+    dst[i] = (unsigned char) (g < 0.0 ? 0.0 : g > 255.0 ? 255.0 : g);
+  }
+}
+
+// Entries of the palette that the fragment shaders color the single-channel
+// texels with: entry i is the color of temperature 2 i / (COLORMAP_SIZE - 1),
+// sampled with linear filtering at u / 2.  Red steps every 1/255 of u, so a
+// palette of 256 entries, one per step of to_luminance, reproduced only
+// every other red; this one has four entries per step of to_luminance, so
+// that its texels still land on entries.  to_rgba_pixel truncates, which no
+// palette reproduces exactly: the shaders match it to within one step per
+// component, and to within two steps of blue from to_luminance (see
+// heat_bench -V).
+#define COLORMAP_SIZE 1021  // 4 * 255 + 1
+
+// Fills the COLORMAP_SIZE RGBA entries of the palette at lut.
+static inline void fill_colormap(unsigned char *lut) {
+  for (int i = 0; i < COLORMAP_SIZE; ++i)
+    to_rgba_pixel(lut + 4 * i, 2.0 * i / (COLORMAP_SIZE - 1));
+}
+
+#endif //CILKHEATDEMO2_SIMD_H
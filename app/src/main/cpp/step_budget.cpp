@@ -0,0 +1,48 @@
+/* Frame-deadline budget for the timesteps of each frame.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "step_budget.h"
+
+// Weight of the newest sample in the means.
+#define BUDGET_EWMA 0.125
+
+int StepBudget::plan(uint64_t elapsed_ns, double cells) {
+  carry = min(carry + double(elapsed_ns) * REAL_TIME_PER_TSTEP, double(MAX_CARRY_TSTEPS));
+  int steps = min(int(carry), DEFAULT_TSTEP);
+  if (deadline_ns > 0 && ns_per_cell > 0 && cells > 0) {
+    double budget = max(double(deadline_ns) - other_ns, MIN_STENCIL_SHARE * deadline_ns);
+    double fit = budget / (ns_per_cell * cells);
+    steps = min(steps, max(1, int(min(fit, double(DEFAULT_TSTEP)))));
+  }
+  carry -= steps;
+  return steps;
+}
+
+void StepBudget::record(int steps, double cells, uint64_t stencil_ns, uint64_t rest_ns) {
+  if (steps > 0 && cells > 0) {
+    double c = double(stencil_ns) / (steps * cells);
+    ns_per_cell = ns_per_cell > 0 ? ns_per_cell + BUDGET_EWMA * (c - ns_per_cell) : c;
+  }
+  other_ns = other_ns > 0 ? other_ns + BUDGET_EWMA * (double(rest_ns) - other_ns)
+                          : double(rest_ns);
+}
@@ -0,0 +1,89 @@
+/* Frame-deadline budget for the timesteps of each frame.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef CILKHEATDEMO2_STEP_BUDGET_H
+#define CILKHEATDEMO2_STEP_BUDGET_H
+
+#include "common.h"
+#include "sim.h"
+
+// One frame at 60 Hz.
+#define DEFAULT_DEADLINE_NS 16600000
+
+// Share of the deadline that the stencil keeps however much the rest of
+// the frame costs, so that the simulation never stalls.
+#define MIN_STENCIL_SHARE 0.25
+
+// Most timesteps of real time owed that are carried to later frames.
+// Beyond it the simulation runs slower than real time instead of catching
+// up in a burst.
+#define MAX_CARRY_TSTEPS (2 * DEFAULT_TSTEP)
+
+// Chooses how many timesteps each frame runs.  Real time accrues timesteps
+// owed at REAL_TIME_PER_TSTEP, and a frame runs those owed, up to
+// DEFAULT_TSTEP and up to as many as the measured cost per cell update
+// fits into the deadline less what the rest of the frame costs; whatever
+// is left is carried over.  Unlike running what the previous frame's
+// length calls for, a slow frame does not make the next one slower.
+class StepBudget {
+public:
+  // Deadline of a frame in nanoseconds; 0 runs whatever is owed up to
+  // DEFAULT_TSTEP, regardless of cost.
+  void set_deadline(uint64_t ns) {
+    deadline_ns = ns;
+  }
+
+  uint64_t deadline() const {
+    return deadline_ns;
+  }
+
+  // Forgets the costs measured and the time owed, as when the algorithm,
+  // grid or cutoffs change.
+  void reset() {
+    carry = 0;
+    ns_per_cell = 0;
+    other_ns = 0;
+  }
+
+  // Timesteps for a frame on a grid of cells cells, elapsed_ns after the
+  // previous frame; 0 if less than one is owed.
+  int plan(uint64_t elapsed_ns, double cells);
+
+  // Records that the steps planned for a frame took stencil_ns and the
+  // rest of it took rest_ns.
+  void record(int steps, double cells, uint64_t stencil_ns, uint64_t rest_ns);
+
+  // Timesteps owed to real time after the last plan.
+  double owed() const {
+    return carry;
+  }
+
+private:
+  uint64_t deadline_ns = DEFAULT_DEADLINE_NS;
+  double carry = 0;
+  // Exponentially weighted means; 0 until measured.
+  double ns_per_cell = 0;
+  double other_ns = 0;
+};
+
+#endif  // CILKHEATDEMO2_STEP_BUDGET_H
@@ -0,0 +1,58 @@
+/* Timing of the stencil algorithms, shared by heat_bench and autotune.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <vector>
+#include "timing.h"
+#include "frame_stats.h"
+
+void init_state(SimState *Q) {
+  Q->clear();
+  int r = max(1, min(Q->X, Q->Y) / 16);
+  for (int x = Q->X / 2 - r; x < Q->X / 2 + r; ++x)
+    for (int y = Q->Y / 2 - r; y < Q->Y / 2 + r; ++y)
+      Raster(Q, y, x) = 1;
+  Q->heat_inc = 0.2f;
+  Q->update_heat();
+}
+
+double time_algorithm(const Algorithm *algo, SimState *Q, int T, int reps) {
+  const uint64_t min_sample_ns = 10000000;
+  init_state(Q);
+  // Warm up, and batch runs so that each sample takes at least
+  // min_sample_ns.
+  uint64_t start = now_ns();
+  algo->fn(Q, 0, T, 0, Q->X, 0, Q->Y);
+  uint64_t elapsed = now_ns() - start;
+  int batch = elapsed >= min_sample_ns ? 1 : int(min(1000, min_sample_ns / (elapsed + 1) + 1));
+
+  std::vector<double> samples;
+  int t = T;
+  for (int rep = 0; rep < reps; ++rep) {
+    start = now_ns();
+    for (int b = 0; b < batch; ++b, t += T)
+      algo->fn(Q, t, t + T, 0, Q->X, 0, Q->Y);
+    samples.push_back(double(now_ns() - start) * 1e-9 / batch);
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
@@ -0,0 +1,39 @@
+/* Timing of the stencil algorithms, shared by heat_bench and autotune.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_TIMING_H
+#define CILKHEATDEMO2_TIMING_H
+
+#include "common.h"
+#include "sim.h"
+#include "algorithms.h"
+
+// Resets Q and puts a square heat source in the middle of the grid,
+// roughly what a single touch on the device produces.
+void init_state(SimState *Q);
+
+// Runs algo for T timesteps on a freshly initialized Q reps times and
+// returns the median wall-clock time of one run in seconds.  Runs that are
+// too short to time reliably are batched.
+double time_algorithm(const Algorithm *algo, SimState *Q, int T, int reps);
+
+#endif  // CILKHEATDEMO2_TIMING_H
@@ -0,0 +1,119 @@
+/* Lock-free queue of touch events from the UI thread to the GL thread.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_TOUCH_RING_H
+#define CILKHEATDEMO2_TOUCH_RING_H
+
+#include <atomic>
+#include <cstdint>
+
+// Fixed-capacity single-producer, single-consumer ring.  push is called
+// only by the producer and drain only by the consumer; neither blocks or
+// allocates.
+template<typename T, int LgN>
+class SpscRing {
+public:
+  static constexpr uint32_t N = 1u << LgN;
+
+  // Appends v, or returns false if fewer than reserve + 1 slots are free.
+  bool push(const T &v, uint32_t reserve = 0) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) >= N - reserve)
+      return false;
+    buf[t & (N - 1)] = v;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Passes every queued element, oldest first, to f and removes them.
+  // Returns the number of elements drained.
+  template<typename F>
+  uint32_t drain(F f) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    for (uint32_t i = h; i != t; ++i)
+      f(buf[i & (N - 1)]);
+    head.store(t, std::memory_order_release);
+    return t - h;
+  }
+
+private:
+  T buf[N];
+  // Kept on separate cache lines so that the two threads do not contend.
+  alignas(64) std::atomic<uint32_t> head{0};  // Written by the consumer.
+  alignas(64) std::atomic<uint32_t> tail{0};  // Written by the producer.
+};
+
+// Pointers with ids past this are ignored.
+#define MAX_POINTERS 10
+
+// A touch of pointer id at window coordinates (x, y), or its release.
+struct TouchEvent {
+  int id;
+  float x, y;
+  bool up;
+};
+
+// Producer side of the touch queue, with coalescing.  Repeated moves of a
+// pointer to the same point and repeated releases are dropped.  Moves may
+// fill only N - MAX_POINTERS slots, so that the release that ends each
+// pointer's burst always fits; moves past that are dropped and the trail
+// jumps straight to the next point that fits, which costs one straight
+// segment instead of an overrun.  Once moves stop fitting, each pointer can
+// queue at most one more release before its next move, so the reserve is
+// never exceeded.
+template<int LgN>
+class TouchQueue {
+public:
+  static constexpr uint32_t Capacity = SpscRing<TouchEvent, LgN>::N;
+  static_assert(Capacity > MAX_POINTERS, "ring too small for the pointers");
+
+  TouchQueue() {
+    for (TouchEvent &l : last)
+      l = {0, 0, 0, true};
+  }
+
+  // Called by the producer.
+  void push(TouchEvent e) {
+    if (e.id < 0 || e.id >= MAX_POINTERS)
+      return;
+    TouchEvent &l = last[e.id];
+    if (e.up ? l.up : !l.up && e.x == l.x && e.y == l.y)
+      return;
+    if (ring.push(e, e.up ? 0 : MAX_POINTERS))
+      l = e;
+  }
+
+  // Called by the consumer; see SpscRing::drain.  At most Capacity events
+  // are drained per call.
+  template<typename F>
+  uint32_t drain(F f) {
+    return ring.drain(f);
+  }
+
+private:
+  SpscRing<TouchEvent, LgN> ring;
+  // Last event queued for each pointer; producer-only.
+  TouchEvent last[MAX_POINTERS];
+};
+
+#endif  // CILKHEATDEMO2_TOUCH_RING_H
@@ -0,0 +1,503 @@
+/* Bit-exact cross-algorithm verification for the stencil algorithms.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "dirty_tiles.h"
+#include "sim_resize.h"
+
+namespace {
+
+enum Pattern {
+  PATTERN_EMPTY,   // No heat source.
+  PATTERN_DOTS,    // Scattered single cells.
+  PATTERN_TRAIL,   // Line segments, like a touch trail.
+  PATTERN_BORDER,  // Sources on the boundary cells.
+  PATTERN_FULL,    // Every cell, like the full-screen patterns.
+  NUM_PATTERNS
+};
+
+const char *const pattern_names[NUM_PATTERNS] = {
+    "empty", "dots", "trail", "border", "full"
+};
+
+void draw_line(SimState *Q, int x0, int y0, int x1, int y1) {
+  int n = max(abs(x1 - x0), abs(y1 - y0));
+  for (int i = 0; i <= n; ++i) {
+    int x = n ? x0 + (x1 - x0) * i / n : x0;
+    int y = n ? y0 + (y1 - y0) * i / n : y0;
+    Raster(Q, y, x) = 1;
+  }
+}
+
+void fill_pattern(SimState *Q, Pattern pattern, std::mt19937 &rng) {
+  std::uniform_int_distribution<int> rx(0, Q->X - 1), ry(0, Q->Y - 1);
+  switch (pattern) {
+    case PATTERN_EMPTY:
+      break;
+    case PATTERN_DOTS:
+      for (int i = 0; i < Q->X * Q->Y / 100 + 1; ++i)
+        Raster(Q, ry(rng), rx(rng)) = 1;
+      break;
+    case PATTERN_TRAIL: {
+      int x = rx(rng), y = ry(rng);
+      for (int i = 0; i < 8; ++i) {
+        int nx = rx(rng), ny = ry(rng);
+        draw_line(Q, x, y, nx, ny);
+        x = nx;
+        y = ny;
+      }
+      break;
+    }
+    case PATTERN_BORDER:
+      for (int x = 0; x < Q->X; ++x) {
+        Raster(Q, 0, x) = 1;
+        Raster(Q, Q->Y - 1, x) = 1;
+      }
+      for (int y = 0; y < Q->Y; ++y) {
+        Raster(Q, y, 0) = 1;
+        Raster(Q, y, Q->X - 1) = 1;
+      }
+      break;
+    case PATTERN_FULL:
+      for (int x = 0; x < Q->X; ++x)
+        for (int y = 0; y < Q->Y; ++y)
+          Raster(Q, y, x) = 1;
+      break;
+    default:
+      break;
+  }
+}
+
+// Largest absolute difference between the grids of A and B at timestep t.
+double max_abs_diff(const SimState *A, const SimState *B, int t) {
+  double diff = 0.0;
+  for (int x = 0; x < A->X; ++x)
+    for (int y = 0; y < A->Y; ++y)
+      diff = max(diff, fabs(A->value(t, x, y) - B->value(t, x, y)));
+  return diff;
+}
+
+// Copies the grid at timestep t, the raster and heat_inc from src into dst,
+// which may use a different layout and precision.
+void copy_state(SimState *dst, const SimState *src, int t) {
+  dst->clear();
+  for (int x = 0; x < src->X; ++x)
+    for (int y = 0; y < src->Y; ++y) {
+      dst->set_value(t, x, y, src->value(t, x, y));
+      Raster(dst, y, x) = Raster(src, y, x);
+    }
+  dst->heat_inc = src->heat_inc;
+}
+
+// Bytes per cell of each OutputFormat.
+const int output_bytes[] = {4, 2, 4, 1};
+
+// Number of cells of Q at timestep t whose conversion in out differs from
+// converting the finished grid.
+int output_mismatches(const SimState *Q, const OutputSink *out, int t) {
+  std::vector<unsigned char> expect(out->pitch * Q->Y);
+  OutputSink ref = *out;
+  ref.dst = expect.data();
+  with_sim_view(Q, [&](auto *V) {
+    for (int y = 0; y < Q->Y; ++y)
+      V->output_row(&ref, t, y, 0, Q->X);
+  });
+  int bytes = output_bytes[out->format], bad = 0;
+  for (int y = 0; y < Q->Y; ++y)
+    for (int x = 0; x < Q->X; ++x) {
+      size_t k = out->pitch * y + size_t(bytes) * x;
+      bad += memcmp(out->dst + k, ref.dst + k, bytes) != 0;
+    }
+  return bad;
+}
+
+// Number of errors in what the base cases recorded in c, whose codes held
+// those of before, for Q at timestep t: tiles flagged, or not, against a
+// comparison of the codes, and codes left different from Q's.
+int change_mismatches(const SimState *Q, const ChangeSink *c, const uint16_t *before, int t) {
+  std::vector<uint8_t> expect(size_t(c->tiles_x) * DirtyTiles::tiles_for(Q->Y));
+  int bad = 0;
+  for (int y = 0; y < Q->Y; ++y)
+    for (int x = 0; x < Q->X; ++x) {
+      size_t k = size_t(y) * c->pitch + x;
+      uint16_t q = color_code(float(Q->value(t, x, y)));
+      bad += c->codes[k] != q;
+      if (q != before[k])
+        expect[size_t(y / c->tile) * c->tiles_x + x / c->tile] = 1;
+    }
+  for (size_t i = 0; i < expect.size(); ++i)
+    bad += c->changed[i] != expect[i];
+  return bad;
+}
+
+// Color channel c of a grid value, as renderTexture computes it.
+int color(double u, int c) {
+  double v = c == 0 ? u : c == 1 ? 0.5 * u : 1 - 0.8 * u;
+  return int(min(0xFF, max(0.0, 0xFF * v)));
+}
+
+// Resizes a linear field to its own size, which must keep it exactly at
+// the state's precision.  Then, since bilinear resampling keeps it up to
+// the clamped border cells, resizes it through several sizes and back,
+// checking that the rotation reuses the buffers.  Then steps the resized
+// state, whose buffers are larger than its grid, with the walker the
+// renderer uses and compares it against rect_loops_serial on a fresh state
+// holding the same values.  Returns the number of failures.
+int verify_resize(SimLayout layout, SimPrecision precision, std::mt19937 &rng) {
+  const int X = 100, Y = 60, lt = DEFAULT_TSTEP;
+  const int sizes[][2] = {{Y, X}, {50, 30}, {200, 120}, {X, Y}};
+  auto field = [&](int x, int y) { return 0.5 * (x + 0.5) / X + 0.4 * (y + 0.5) / Y; };
+  const char *name = "";
+  int failures = 0;
+
+  SimState *Q = new SimState(X, Y, true, layout, precision);
+  Q->set_sim_size(X, Y, lt);
+  for (int x = 0; x < X; ++x)
+    for (int y = 0; y < Y; ++y)
+      Q->set_value(0, x, y, field(x, y));
+  std::vector<double> before(size_t(X) * Y);
+  for (int x = 0; x < X; ++x)
+    for (int y = 0; y < Y; ++y)
+      before[size_t(y) * X + x] = Q->value(0, x, y);
+  ResizeScratch scratch;
+  resize_sim(Q, 0, X, Y, &scratch);
+  for (int x = 0; x < X; ++x)
+    for (int y = 0; y < Y; ++y)
+      if (Q->value(0, x, y) != before[size_t(y) * X + x]) {
+        name = "same size";
+        failures++;
+        x = X;
+        break;
+      }
+  for (auto size : sizes) {
+    size_t capacity = Q->capacity;
+    resize_sim(Q, 0, size[0], size[1], &scratch);
+    if (size[0] == Y && size[1] == X && Q->capacity != capacity) {
+      name = "rotation reallocated";
+      failures++;
+    }
+  }
+  double err = 0.0;
+  for (int x = 0; x < X; ++x)
+    for (int y = 0; y < Y; ++y)
+      err = max(err, fabs(Q->value(0, x, y) - field(x, y)));
+  if (err > 0.02) {
+    name = "round trip";
+    failures++;
+  }
+
+  fill_pattern(Q, PATTERN_TRAIL, rng);
+  Q->heat_inc = 0.25f;
+  SimState *fresh = new SimState(X, Y, true, layout, precision);
+  fresh->set_sim_size(X, Y, lt);
+  copy_state(fresh, Q, 0);
+  Q->update_heat();
+  fresh->update_heat();
+  default_algorithm()->fn(Q, 0, lt, 0, X, 0, Y);
+  rect_loops_serial(fresh, 0, lt, 0, X, 0, Y);
+  double diff = max_abs_diff(Q, fresh, lt);
+  if (diff != 0.0) {
+    name = "stepping";
+    failures++;
+  }
+  printf("  %-13s %-6s round trip max |err| %-10g step max |diff| %-10g %s%s\n",
+         layout_name(layout), precision_name(precision), err, diff,
+         failures ? "FAILED: " : "ok", name);
+  delete fresh;
+  delete Q;
+  return failures;
+}
+
+// Value of a half-precision float.
+float half_value(uint16_t h) {
+  int e = (h >> 10) & 0x1f, m = h & 0x3ff;
+  float v = e == 0 ? ldexpf(float(m), -24) : ldexpf(float(0x400 | m), e - 25);
+  return h & 0x8000 ? -v : v;
+}
+
+// Colors temperatures through each single-channel output format and the
+// palette of fill_colormap, as the fragment shaders do (with the palette
+// filtered linearly and the result rounded to 8 bits), and checks that they
+// stay within the tolerance that fill_colormap documents of to_rgba_pixel.
+// Returns the number of failures.
+int verify_colormap() {
+  static unsigned char lut[4 * COLORMAP_SIZE];
+  fill_colormap(lut);
+  const OutputFormat formats[] = {OUT_HALF, OUT_FLOAT, OUT_LUMINANCE};
+  const int samples = 1 << 20;
+  int failures = 0;
+  for (OutputFormat format : formats) {
+    // The shaders scale the texel to u / 2, which TEX_LUMINANCE holds.
+    float scale = format == OUT_LUMINANCE ? 1.0f : 0.5f;
+    int tolerance[3] = {1, 1, format == OUT_LUMINANCE ? 2 : 1};
+    int worst[3] = {}, off = 0;
+    for (int k = 0; k <= samples; ++k) {
+      double u = 2.2 * k / samples - 0.1;
+      float v;
+      if (format == OUT_HALF) {
+        uint16_t h;
+        to_half<1>(&h, &u, 1);
+        v = half_value(h);
+      } else if (format == OUT_FLOAT) {
+        to_float<1>(&v, &u, 1);
+      } else {
+        unsigned char l;
+        to_luminance<1>(&l, &u, 1);
+        v = l / 255.0f;
+      }
+      float p = min(max(v * scale, 0.0f), 1.0f) * (COLORMAP_SIZE - 1);
+      int i = min(int(p), COLORMAP_SIZE - 2);
+      float f = p - i;
+      unsigned char expect[4];
+      to_rgba_pixel(expect, u);
+      bool differs = false;
+      for (int c = 0; c < 3; ++c) {
+        float shaded = lut[4 * i + c] + f * (lut[4 * (i + 1) + c] - lut[4 * i + c]);
+        int d = abs(int(lrintf(shaded)) - expect[c]);
+        worst[c] = max(worst[c], d);
+        differs |= d != 0;
+      }
+      off += differs;
+    }
+    bool ok = true;
+    for (int c = 0; c < 3; ++c)
+      ok &= worst[c] <= tolerance[c];
+    failures += !ok;
+    printf("  %-10s max steps off r %d g %d b %d, %5.1f%% of temperatures off  %s\n",
+           format == OUT_HALF ? "r16f" : format == OUT_FLOAT ? "r32f" : "luminance",
+           worst[0], worst[1], worst[2], 100.0 * off / (samples + 1), ok ? "ok" : "FAILED");
+  }
+  return failures;
+}
+
+}  // namespace
+
+int run_verify(int trials, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::vector<double> worst[NUM_PRECISIONS];
+  double precision_error[NUM_PRECISIONS] = {};
+  int failures = 0;
+
+  for (int p = 0; p < NUM_PRECISIONS; ++p)
+    worst[p].assign(num_algorithms, 0.0);
+  printf("verifying against loops_serial, %d trials, seed %u\n", trials, seed);
+  for (int trial = 0; trial < trials; ++trial) {
+    // Mostly small grids, with an occasional large one.
+    int limit = trial % 8 == 7 ? 1200 : 300;
+    int X = std::uniform_int_distribution<int>(3, limit)(rng);
+    int Y = std::uniform_int_distribution<int>(3, limit)(rng);
+    int t0 = std::uniform_int_distribution<int>(0, 3)(rng);
+    int lt = std::uniform_int_distribution<int>(1, 2 * DEFAULT_TSTEP)(rng);
+    Pattern pattern = Pattern(std::uniform_int_distribution<int>(0, NUM_PATTERNS - 1)(rng));
+
+    SimState *init = new SimState(X, Y, true);
+    init->set_sim_size(X, Y, lt);
+    fill_pattern(init, pattern, rng);
+    init->heat_inc = std::uniform_real_distribution<float>(0.0f, 0.5f)(rng);
+    std::uniform_real_distribution<double> val(0.0, 1.0);
+    for (int x = 0; x < X; ++x)
+      for (int y = 0; y < Y; ++y)
+        U(init, t0, x, y) = val(rng);
+
+    printf("trial %d: %d x %d, t = [%d, %d), pattern %s\n",
+           trial, X, Y, t0, t0 + lt, pattern_names[pattern]);
+    // Every other small trial runs the walkers with random cutoffs, which
+    // must change only their speed.
+    WalkParams walk;
+    if (trial % 2 && trial % 8 != 7) {
+      auto in = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+      walk.x_stop = in(4, 128);
+      walk.y_stop = in(4, 128);
+      walk.dt_stop = in(1, 12);
+      walk.lt_thresh = in(1, 64);
+      walk.coarsen = in(1, 12);
+      printf("  cutoffs: x_stop %d y_stop %d dt_stop %d lt_thresh %d coarsen %d\n", walk.x_stop,
+             walk.y_stop, walk.dt_stop, walk.lt_thresh, walk.coarsen);
+    }
+    SimState *ref[NUM_PRECISIONS];
+    for (int p = 0; p < NUM_PRECISIONS; ++p) {
+      SimPrecision precision = SimPrecision(p);
+      ref[p] = new SimState(X, Y, true, LAYOUT_TIME_INNER, precision);
+      ref[p]->set_sim_size(X, Y, lt);
+      copy_state(ref[p], init, t0);
+      rect_loops_serial(ref[p], t0, t0 + lt, 0, X, 0, Y);
+      precision_error[p] = max(precision_error[p], max_abs_diff(ref[p], ref[0], t0 + lt));
+
+      for (int l = 0; l < NUM_LAYOUTS; ++l) {
+        SimLayout layout = SimLayout(l);
+        SimState *start = new SimState(X, Y, true, layout, precision);
+        start->set_sim_size(X, Y, lt);
+        copy_state(start, init, t0);
+        // Alternate between dense and sparse heat.
+        bool sparse = (trial + l) % 2;
+        start->update_heat();
+        start->heat_sparse = sparse;
+        SimState *Q = new SimState(X, Y, true, layout, precision);
+        Q->set_sim_size(X, Y, lt);
+        Q->walk = walk;
+        // The algorithms that can fuse the conversion of the last timestep
+        // write it here, in a format that changes from trial to trial.
+        OutputFormat format = OutputFormat((trial + l) % 4);
+        std::vector<unsigned char> fused(size_t(output_bytes[format]) * X * Y);
+        OutputSink sink = {t0 + lt, format, fused.data(), size_t(output_bytes[format]) * X};
+        // They also flag the tiles whose codes change from those of start.
+        int tiles_x = DirtyTiles::tiles_for(X);
+        std::vector<uint16_t> before(size_t(X) * Y), codes(before.size());
+        std::vector<uint8_t> changed(size_t(tiles_x) * DirtyTiles::tiles_for(Y));
+        for (int y = 0; y < Y; ++y)
+          for (int x = 0; x < X; ++x)
+            before[size_t(y) * X + x] = color_code(float(start->value(t0, x, y)));
+        ChangeSink changes = {t0 + lt, codes.data(), X, changed.data(), tiles_x, DIRTY_TILE};
+        for (int i = 0; i < num_algorithms; ++i) {
+          const Algorithm *algo = &algorithms[i];
+          if (!(algo->flags & ALG_STENCIL))
+            continue;
+          Q->copy_from(start);
+          bool fuse = algo->flags & ALG_FUSED_OUTPUT;
+          if (fuse) {
+            memset(fused.data(), 0xA5, fused.size());
+            Q->output = &sink;
+            codes = before;
+            memset(changed.data(), 0, changed.size());
+            Q->changes = &changes;
+          }
+          algo->fn(Q, t0, t0 + lt, 0, X, 0, Y);
+          Q->output = nullptr;
+          Q->changes = nullptr;
+          if (fuse) {
+            int bad = output_mismatches(Q, &sink, t0 + lt);
+            if (bad) {
+              printf("  %-24s %-13s %-6s %-6s %d cells of fused output differ  MISMATCH\n",
+                     algo->name, layout_name(layout), precision_name(precision),
+                     sparse ? "sparse" : "dense", bad);
+              failures++;
+            }
+            bad = change_mismatches(Q, &changes, before.data(), t0 + lt);
+            if (bad) {
+              printf("  %-24s %-13s %-6s %-6s %d change flags or codes differ  MISMATCH\n",
+                     algo->name, layout_name(layout), precision_name(precision),
+                     sparse ? "sparse" : "dense", bad);
+              failures++;
+            }
+          }
+          double diff = max_abs_diff(Q, ref[p], t0 + lt);
+          worst[p][i] = max(worst[p][i], diff);
+          if (diff != 0.0) {
+            printf("  %-24s %-13s %-6s %-6s max |diff| = %g%s\n", algo->name,
+                   layout_name(layout), precision_name(precision), sparse ? "sparse" : "dense",
+                   diff,
+                   (algo->flags & ALG_EXPERIMENTAL) ? " (experimental)" : "  MISMATCH");
+            if (!(algo->flags & ALG_EXPERIMENTAL))
+              failures++;
+          }
+        }
+        delete Q;
+        delete start;
+      }
+    }
+    for (int p = 0; p < NUM_PRECISIONS; ++p)
+      delete ref[p];
+    delete init;
+  }
+
+  printf("resize:\n");
+  for (int p = 0; p < NUM_PRECISIONS; ++p)
+    for (int l = 0; l < NUM_LAYOUTS; ++l)
+      failures += verify_resize(SimLayout(l), SimPrecision(p), rng);
+
+  printf("colormap (shaded by the palette vs to_rgba_pixel):\n");
+  failures += verify_colormap();
+
+  printf("summary (max |diff| over all trials and layouts, per precision):\n");
+  printf("  %-24s", "");
+  for (int p = 0; p < NUM_PRECISIONS; ++p)
+    printf(" %-10s", precision_name(SimPrecision(p)));
+  printf("\n");
+  for (int i = 0; i < num_algorithms; ++i) {
+    const Algorithm *algo = &algorithms[i];
+    if (!(algo->flags & ALG_STENCIL))
+      continue;
+    double w = 0.0;
+    printf("  %-24s", algo->name);
+    for (int p = 0; p < NUM_PRECISIONS; ++p) {
+      printf(" %-10g", worst[p][i]);
+      w = max(w, worst[p][i]);
+    }
+    printf(" %s\n", w == 0.0 ? "bit-exact" :
+           (algo->flags & ALG_EXPERIMENTAL) ? "differs (experimental)" : "FAILED");
+  }
+  printf("loops_serial max |diff| from double:");
+  for (int p = 1; p < NUM_PRECISIONS; ++p)
+    printf(" %s %g", precision_name(SimPrecision(p)), precision_error[p]);
+  printf("\n");
+  return failures > 0 ? 1 : 0;
+}
+
+int run_precision_report(int X, int Y, int T, const Algorithm *algo) {
+  // The layout the renderer uses.
+  const SimLayout layout = LAYOUT_TIME_OUTER;
+  SimState *Q[NUM_PRECISIONS];
+  double secs[NUM_PRECISIONS];
+
+  printf("algorithm %s, grid %d x %d, %d timesteps in frames of %d, layout %s\n",
+         algo->name, X, Y, T, DEFAULT_TSTEP, layout_name(layout));
+  for (int p = 0; p < NUM_PRECISIONS; ++p) {
+    Q[p] = new SimState(X, Y, true, layout, SimPrecision(p));
+    Q[p]->set_sim_size(X, Y, DEFAULT_TSTEP);
+    init_state(Q[p]);
+    uint64_t start = now_ns();
+    for (int t = 0; t < T; t += DEFAULT_TSTEP)
+      algo->fn(Q[p], t, min(T, t + DEFAULT_TSTEP), 0, X, 0, Y);
+    secs[p] = double(now_ns() - start) * 1e-9;
+  }
+
+  printf("%-8s %-12s %-12s %-12s %-14s %s\n",
+         "", "cells/s", "max |err|", "rms err", "max |err|/max", "pixels off");
+  for (int p = 0; p < NUM_PRECISIONS; ++p) {
+    double max_err = 0.0, sum_sq = 0.0, peak = 0.0;
+    long pixels = 0;
+    for (int x = 0; x < X; ++x)
+      for (int y = 0; y < Y; ++y) {
+        double ref = Q[PREC_DOUBLE]->value(T, x, y);
+        double v = Q[p]->value(T, x, y);
+        double err = fabs(v - ref);
+        max_err = max(max_err, err);
+        sum_sq += err * err;
+        peak = max(peak, fabs(ref));
+        for (int c = 0; c < 3; ++c) {
+          if (color(v, c) != color(ref, c)) {
+            pixels++;
+            break;
+          }
+        }
+      }
+    printf("%-8s %-12.4g %-12.4g %-12.4g %-14.4g %ld of %ld\n",
+           precision_name(SimPrecision(p)), double(X) * Y * T / secs[p], max_err,
+           sqrt(sum_sq / (double(X) * Y)), peak > 0.0 ? max_err / peak : 0.0,
+           pixels, long(X) * Y);
+  }
+  for (int p = 0; p < NUM_PRECISIONS; ++p)
+    delete Q[p];
+  return 0;
+}
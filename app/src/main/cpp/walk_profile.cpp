@@ -0,0 +1,171 @@
+/* Work and span profiling of the trapezoid walkers.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "walk_profile.h"
+#include "frame_stats.h"
+
+namespace walk_profile {
+
+#if WALK_PROFILE
+
+namespace {
+
+// A spawned call or a cilk_scope.  Times are relative to its start; child
+// is when the last of its spawned children finishes.
+struct Frame {
+  uint64_t span, child;
+  uint64_t bspan, bchild;  // Burdened.
+  uint64_t start, bstart;  // The parent's span when this began.
+};
+
+const int MAX_DEPTH = 512;
+Frame frames[MAX_DEPTH];
+int depth = 0;  // 0 outside begin and end.
+uint64_t last_ns;
+WalkStats stats;
+
+// Charges the time since the last hook to the innermost frame.
+void tick() {
+  uint64_t now = now_ns();
+  uint64_t d = now - last_ns;
+  last_ns = now;
+  Frame &f = frames[depth - 1];
+  f.span += d;
+  f.bspan += d;
+  stats.work_ns += d;
+}
+
+void push() {
+  assert(depth < MAX_DEPTH);
+  const Frame &p = frames[depth - 1];
+  frames[depth++] = {0, 0, 0, 0, p.span, p.bspan};
+}
+
+}  // namespace
+
+bool available() {
+  return true;
+}
+
+void begin() {
+  stats = {};
+  frames[0] = {};
+  depth = 1;
+  last_ns = now_ns();
+}
+
+WalkStats end() {
+  tick();
+  const Frame &f = frames[0];
+  stats.span_ns = max(f.span, f.child);
+  stats.burdened_span_ns = max(f.bspan, f.bchild);
+  depth = 0;
+  return stats;
+}
+
+void spawn_begin() {
+  if (depth == 0)
+    return;
+  tick();
+  push();
+  stats.spawns++;
+}
+
+void spawn_end() {
+  if (depth == 0)
+    return;
+  tick();
+  const Frame &c = frames[--depth];
+  Frame &p = frames[depth - 1];
+  p.child = max(p.child, c.start + max(c.span, c.child));
+  p.bchild = max(p.bchild, c.bstart + max(c.bspan, c.bchild) + WALK_BURDEN_NS);
+}
+
+void scope_begin() {
+  if (depth == 0)
+    return;
+  tick();
+  push();
+}
+
+// The scope's strand continues in its parent once its children are done.
+void scope_end() {
+  if (depth == 0)
+    return;
+  tick();
+  const Frame &s = frames[--depth];
+  Frame &p = frames[depth - 1];
+  p.span += max(s.span, s.child);
+  p.bspan += max(s.bspan, s.bchild);
+}
+
+void sync() {
+  if (depth == 0)
+    return;
+  tick();
+  Frame &f = frames[depth - 1];
+  f.span = max(f.span, f.child);
+  f.bspan = max(f.bspan, f.bchild);
+}
+
+void leaf(int t0, int t1, int x0, int dx0, int x1, int dx1,
+          int y0, int dy0, int y1, int dy1) {
+  if (depth == 0)
+    return;
+  double cells = 0;
+  for (int t = t0; t < t1; ++t) {
+    int i = t - t0;
+    int w = x1 - x0 + (dx1 - dx0) * i, h = y1 - y0 + (dy1 - dy0) * i;
+    if (w > 0 && h > 0)
+      cells += double(w) * h;
+  }
+  int bin = 0;
+  while (bin + 1 < WALK_HIST_BINS && cells >= ldexp(1.0, bin + 1))
+    ++bin;
+  stats.leaves++;
+  stats.leaf_cells += cells;
+  stats.leaf_hist[bin]++;
+}
+
+#else
+
+bool available() {
+  return false;
+}
+
+void begin() {}
+
+WalkStats end() {
+  return {};
+}
+
+void spawn_begin() {}
+void spawn_end() {}
+void scope_begin() {}
+void scope_end() {}
+void sync() {}
+
+void leaf(int, int, int, int, int, int, int, int, int, int) {}
+
+#endif
+
+}  // namespace walk_profile
@@ -0,0 +1,120 @@
+/* Work and span profiling of the trapezoid walkers.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CILKHEATDEMO2_WALK_PROFILE_H
+#define CILKHEATDEMO2_WALK_PROFILE_H
+
+#include "common.h"
+
+// Leaf sizes are binned by their floor(log2(cells)).
+#define WALK_HIST_BINS 32
+
+// Cost charged to each spawned child's edge in the burdened span: roughly
+// what a steal costs, as Cilkscale's burden of 15000 instructions is.
+#define WALK_BURDEN_NS 5000
+
+// What one profiled call of a walker did.  Work is the time of all its
+// strands and span the time of the longest path through its spawns and
+// syncs; burdened span also charges WALK_BURDEN_NS per spawn on the path.
+// Work divided by span bounds the speedup on any number of workers, and
+// work divided by burdened span estimates it once stealing has its cost.
+struct WalkStats {
+  uint64_t work_ns;
+  uint64_t span_ns;
+  uint64_t burdened_span_ns;
+  long spawns;
+  long leaves;
+  double leaf_cells;  // Cells updated by all the leaves.
+  long leaf_hist[WALK_HIST_BINS];
+};
+
+// The walkers of heat_recursive_dp.cpp record into this when built with
+// WALK_PROFILE (CMake option HEAT_WALK_PROFILE), which replaces the Cilk
+// keywords there with hooks that time the strands between them, in the
+// manner of Cilkscale.  That needs the serial elision, since the hooks
+// keep a single stack of frames; spawned children then run to completion
+// before their continuation, as on one worker.
+namespace walk_profile {
+
+// Whether the walkers were built with the hooks.
+bool available();
+
+// Starts profiling the calls made until end, which returns what they did.
+void begin();
+WalkStats end();
+
+// Hooks, which do nothing outside begin and end.
+void spawn_begin();
+void spawn_end();
+void scope_begin();
+void scope_end();
+void sync();
+
+// A leaf of the walk: the trapezoid of base_case_kernel's arguments.
+void leaf(int t0, int t1, int x0, int dx0, int x1, int dx1,
+          int y0, int dy0, int y1, int dy1);
+
+}  // namespace walk_profile
+
+#if WALK_PROFILE
+#ifdef __cilk
+#error "WALK_PROFILE needs the serial elision (HEAT_SERIAL)"
+#endif
+
+struct WalkSpawn {
+  WalkSpawn() {
+    walk_profile::spawn_begin();
+  }
+  ~WalkSpawn() {
+    walk_profile::spawn_end();
+  }
+};
+
+struct WalkScope {
+  bool entered = false;
+  WalkScope() {
+    walk_profile::scope_begin();
+  }
+  ~WalkScope() {
+    walk_profile::scope_end();
+  }
+  bool once() {
+    bool first = !entered;
+    entered = true;
+    return first;
+  }
+};
+
+// The spawned call runs while the temporary lives, to the end of the
+// full expression.
+#undef cilk_spawn
+#undef cilk_scope
+#undef cilk_sync
+#define cilk_spawn WalkSpawn(),
+#define cilk_scope for (WalkScope walk_scope_; walk_scope_.once();)
+#define cilk_sync walk_profile::sync()
+#define WALK_LEAF(...) walk_profile::leaf(__VA_ARGS__)
+#else
+#define WALK_LEAF(...) ((void) 0)
+#endif
+
+#endif  // CILKHEATDEMO2_WALK_PROFILE_H
@@ -0,0 +1,65 @@
+/* Work and span report of the trapezoid walkers.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <vector>
+#include "bench.h"
+#include "walk_profile.h"
+
+int run_walk_profile(int X, int Y, int T, const std::vector<const Algorithm *> &algos,
+                     SimLayout layout, SimPrecision precision) {
+  if (!walk_profile::available()) {
+    fprintf(stderr, "heat_bench was built without the walker hooks; configure with "
+                    "-DHEAT_WALK_PROFILE=ON\n");
+    return 1;
+  }
+  SimState *Q = new SimState(X, Y, true, layout, precision);
+  Q->set_sim_size(X, Y, T);
+  printf("grid %d x %d, %d timesteps, layout %s, precision %s, burden %d ns per spawn\n",
+         X, Y, T, layout_name(layout), precision_name(precision), WALK_BURDEN_NS);
+  printf("%-24s %10s %10s %8s %10s %8s %8s %8s %10s\n", "algorithm", "work ms", "span ms",
+         "par", "bspan ms", "bpar", "spawns", "leaves", "cells/leaf");
+  std::vector<WalkStats> all;
+  for (const Algorithm *algo : algos) {
+    init_state(Q);
+    // Warm up, then profile the second call.
+    algo->fn(Q, 0, T, 0, X, 0, Y);
+    walk_profile::begin();
+    algo->fn(Q, T, 2 * T, 0, X, 0, Y);
+    WalkStats s = walk_profile::end();
+    all.push_back(s);
+    double work = s.work_ns * 1e-6, span = s.span_ns * 1e-6, bspan = s.burdened_span_ns * 1e-6;
+    printf("%-24s %10.3f %10.3f %8.1f %10.3f %8.1f %8ld %8ld %10.0f\n", algo->name, work, span,
+           span > 0 ? work / span : 0.0, bspan, bspan > 0 ? work / bspan : 0.0, s.spawns,
+           s.leaves, s.leaves ? s.leaf_cells / s.leaves : 0.0);
+  }
+  // Leaves by size: bin k counts leaves of [2^k, 2^(k+1)) cells.
+  printf("leaf cells histogram:\n");
+  for (size_t i = 0; i < algos.size(); ++i) {
+    printf("  %-24s", algos[i]->name);
+    for (int k = 0; k < WALK_HIST_BINS; ++k)
+      if (all[i].leaf_hist[k])
+        printf(" 2^%d:%ld", k, all[i].leaf_hist[k]);
+    printf("\n");
+  }
+  delete Q;
+  return 0;
+}
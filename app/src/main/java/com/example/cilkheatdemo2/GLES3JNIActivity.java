@@ -26,8 +26,36 @@ public class GLES3JNIActivity extends Activity {
 
     @Override protected void onCreate(Bundle icicle) {
         super.onCreate(icicle);
+        // Select the stencil algorithm without recompiling, e.g.,
+        //   adb shell am start -n com.example.cilkheatdemo2/.GLES3JNIActivity \
+        //       --es algorithm walk_dp_xyt
+        // The renderer may outlive a previous activity, so settings go
+        // through the GL thread, which runs queued events before the
+        // surface exists.
         mView = new GLES3JNIView(getApplication());
+        final String algorithm = getIntent().getStringExtra("algorithm");
+        if (algorithm != null) {
+            mView.queueEvent(() -> GLES3JNILib.setAlgorithm(algorithm));
+        }
+        // Likewise the frame deadline, e.g., --ef deadline_ms 33.3 for 30 Hz.
+        if (getIntent().hasExtra("deadline_ms")) {
+            final float deadline = getIntent().getFloatExtra("deadline_ms", 16.6f);
+            mView.queueEvent(() -> GLES3JNILib.setFrameDeadline(deadline));
+        }
         setContentView(mView);
+        // Tune the walker's cutoffs for this device the first time, or
+        // again with --ez retune true.  The search runs in the background
+        // while the view is shown, for ten seconds at most, and the
+        // renderer switches to the result when it is done.
+        final String tuned = algorithm != null ? algorithm : GLES3JNILib.getAlgorithm();
+        final String path = getFilesDir() + "/walk_tune.txt";
+        final boolean retune = getIntent().getBooleanExtra("retune", false);
+        new Thread(() -> {
+            final int[] params = GLES3JNILib.autotune(path, tuned, retune);
+            if (params != null) {
+                mView.queueEvent(() -> GLES3JNILib.setWalkParams(params));
+            }
+        }, "autotune").start();
     }
 
     @Override protected void onPause() {
@@ -29,6 +29,86 @@ public class GLES3JNILib {
      public static native void resize(int width, int height);
      public static native void step();
 
+     // Touches of pointer 0 (setXY, clearXY) or of pointer id; ids from 0
+     // to 9 are tracked.  These must all be called from the same thread
+     // (the UI thread).
      public static native void setXY(float x, float y);
      public static native void clearXY();
+     public static native void setPointer(int id, float x, float y);
+     public static native void clearPointer(int id);
+
+     // Persistent heat sources, kept across surface re-creation.  x, y and
+     // radius are fractions of the view's width and height (radius of its
+     // width); intensity 1 is as hot as a held touch; shape is "disc" or
+     // "gaussian".  These must be called on the GL thread, like
+     // setAlgorithm; setSource returns false if the shape is unknown.
+     public static native boolean setSource(String name, float x, float y, float radius,
+                                            float intensity, String shape);
+     public static native boolean removeSource(String name);
+     public static native void clearSources();
+
+     // Stencil algorithm selection.  setAlgorithm must be called on the GL
+     // thread (e.g., via GLSurfaceView.queueEvent) or before the surface is
+     // created; it returns false if the name is not registered or names an
+     // experimental algorithm, which getAlgorithms leaves out.
+     public static native String[] getAlgorithms();
+     public static native String getAlgorithm();
+     public static native boolean setAlgorithm(String name);
+
+     // Format of the texture uploaded each frame: "r16f" (the default) or
+     // "r32f", colored by the shader, which fall back to "luminance" on ES2,
+     // or "rgba", colored on the CPU.  Must be called on the GL thread;
+     // returns false if the name is unknown.
+     public static native boolean setTextureFormat(String name);
+
+     // Pipelined mode: the simulation runs on a thread of its own and step
+     // draws the newest finished snapshot, so a frame costs only the
+     // drawing.  Kept across surface re-creation; must be called on the GL
+     // thread.  getPipelineStats returns, in milliseconds, the mean and
+     // maximum age of the snapshots drawn and the mean and maximum time
+     // from a touch being handed to the simulation to its being drawn,
+     // followed by the numbers of snapshots published and drawn; maxima
+     // are since the previous call, and all are 0 when not pipelined.
+     public static native void setPipelined(boolean on);
+     public static native float[] getPipelineStats();
+
+     // Has the stencil write the texture while it computes the last
+     // timestep of each frame, instead of converting the grid afterwards,
+     // with the algorithms that support it and when not pipelined.  The
+     // whole texture is then uploaded every frame.  Kept across surface
+     // re-creation; must be called on the GL thread.
+     public static native void setFusedColormap(boolean on);
+
+     // Where the recent frames' time went.  getFramePhases names the
+     // phases; getFrameStats returns, for each in that order, the 50th,
+     // 95th and 99th percentile in milliseconds over the last 256 frames
+     // and the number of frames they cover, followed by the stencil's cell
+     // updates per second.  Upload and draw count only the CPU's share.
+     // Must be called on the GL thread.
+     public static native String[] getFramePhases();
+     public static native float[] getFrameStats();
+
+     // Frame deadline in milliseconds (16.6 by default).  Each frame runs
+     // the timesteps that real time calls for, up to as many as the
+     // stencil's measured speed fits into the deadline less the rest of the
+     // frame; the remainder carries over to later frames.  0 drops the
+     // limit.  Not used while pipelined.  Kept across surface re-creation;
+     // must be called on the GL thread.
+     public static native void setFrameDeadline(float ms);
+     public static native float getFrameDeadline();
+
+     // Cutoffs of the recursive walkers, in the order x_stop, y_stop,
+     // dt_stop, lt_thresh, coarsen.  autotune returns the best ones for
+     // algorithm on this device, from the tuning file at path or, if it has
+     // none or retune is set, by timing the candidates for up to ten
+     // seconds; a search cut short by that is not saved.  It blocks, so
+     // call it off the UI and GL threads; the renderer's stepping skews the
+     // timing somewhat while the view is shown.  It returns null if the
+     // algorithm is unknown.
+     // setWalkParams applies cutoffs, kept across surface re-creation, and
+     // must be called on the GL thread; it returns false unless there are
+     // five, all positive.
+     public static native int[] autotune(String path, String algorithm, boolean retune);
+     public static native boolean setWalkParams(int[] params);
+     public static native int[] getWalkParams();
 }
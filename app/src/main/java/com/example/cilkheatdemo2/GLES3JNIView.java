@@ -40,20 +40,28 @@ class GLES3JNIView extends GLSurfaceView {
     @Override
     public boolean onTouchEvent(MotionEvent e) {
         // MotionEvent reports input details from the touch screen
-        // and other input controls. In this case, you are only
-        // interested in events where the touch position changed.
+        // and other input controls.  Every pointer down heats the grid
+        // along its own trail.
+        int index = e.getActionIndex();
 
-        float x = e.getX();
-        float y = e.getY();
-
-        switch (e.getAction()) {
+        switch (e.getActionMasked()) {
             case MotionEvent.ACTION_DOWN:
+            case MotionEvent.ACTION_POINTER_DOWN:
+                renderer.setPointer(e.getPointerId(index), e.getX(index), e.getY(index));
+                break;
             case MotionEvent.ACTION_MOVE:
-                renderer.setXY(x, y);
+                for (int i = 0; i < e.getPointerCount(); i++) {
+                    renderer.setPointer(e.getPointerId(i), e.getX(i), e.getY(i));
+                }
                 break;
             case MotionEvent.ACTION_UP:
+            case MotionEvent.ACTION_POINTER_UP:
+                renderer.clearPointer(e.getPointerId(index));
+                break;
             case MotionEvent.ACTION_CANCEL:
-                renderer.clearXY();
+                for (int i = 0; i < e.getPointerCount(); i++) {
+                    renderer.clearPointer(e.getPointerId(i));
+                }
                 break;
         }
 
@@ -73,7 +81,7 @@ class GLES3JNIView extends GLSurfaceView {
             GLES3JNILib.init();
         }
 
-        public void setXY(float x, float y) { GLES3JNILib.setXY(x, y); }
-        public void clearXY() { GLES3JNILib.clearXY(); }
+        public void setPointer(int id, float x, float y) { GLES3JNILib.setPointer(id, x, y); }
+        public void clearPointer(int id) { GLES3JNILib.clearPointer(id); }
     }
 }